@@ -0,0 +1,46 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <Search.h>
+#include <Nnue.h>
+
+/*
+* Responsible for measuring engine performance over a fixed set of positions.
+* Run from the command line, e.g. "ChessGUI bench 8" or "ChessGUI bench-smp 8".
+*/
+class Bench
+{
+public:
+	// Nodes, time and move ordering quality to a fixed depth on a single thread
+	static void search(std::ostream& out, int depth);
+
+	// Nodes to depth with each selective search technique switched off in turn
+	static void pruning(std::ostream& out, int depth);
+
+	// Nodes and re-searches for a range of aspiration window sizes
+	static void aspiration(std::ostream& out, int depth);
+
+	// Time-to-depth for 1, 2, 4, 8, 16 and 32 search threads
+	static void smpScaling(std::ostream& out, int depth);
+
+	// Cost of searching the best 1, 2, 3 and 5 root moves against the best one only
+	static void multiPv(std::ostream& out, int depth);
+
+	// FEN parsing and writing speed over the bench positions, in thousands of round trips
+	static void fen(std::ostream& out, int thousands);
+
+	// Speed of the network evaluation against the handcrafted one, e.g. "ChessGUI bench-nnue net.nnue 8"
+	static void nnue(std::ostream& out, const std::string& networkPath, int depth);
+
+private:
+	static const std::vector<std::string> positions;
+
+	static double getPercent(uint64_t part, uint64_t whole);
+
+	// Searches every position from an empty table, returns the total nodes and adds to the time and stats totals
+	static uint64_t searchAll(Search& search, int depth, int64_t& totalMs, Search::Stats& totalStats, std::shared_ptr<const Nnue> network = nullptr, int multiPv = 1);
+	static void printSearchRow(std::ostream& out, const std::string& label, int64_t ms, uint64_t nodes, const Search::Stats& stats);
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 /*
 * Responsbile for managing a 64-bit bitboard.
@@ -45,16 +46,24 @@ public:
 
 	int bitScanForward() const;
 	int bitScanReverse() const;
+	int popCount() const;
 	Bitboard resetLSB();
 	Bitboard isolateLSB();
 
+	// Smears every set bit towards rank 8, towards rank 1, or over its whole file
+	Bitboard northFill() const;
+	Bitboard southFill() const;
+	Bitboard fileFill() const;
+
 	static const Bitboard hFile;
 	static const Bitboard aFile;
 	static const Bitboard gFile;
 	static const Bitboard bFile;
 
+	static const Bitboard rank1;
 	static const Bitboard rank4;
 	static const Bitboard rank5;
+	static const Bitboard rank8;
 
 private:
 	uint64_t bitboard;
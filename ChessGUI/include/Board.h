@@ -3,11 +3,12 @@
 #include <vector>
 #include <string>
 #include <Move.h>
+#include <PositionSnapshot.h>
 
 class Input;
-class Engine;
 /*
-* Responsible for the chess board
+* Responsible for the chess board.
+* Only reads the position through snapshots, so it never touches an engine another thread may be using.
 */
 class Board {
 public:
@@ -15,18 +16,17 @@ public:
 
 	Board(const int& width);
 
-	void update(const Input& input, Engine& engine);
-	void render(sf::RenderWindow& gameWindow, const Engine& engine);
+	// Returns true and fills in the move when the player picks one of the legal moves
+	bool update(const Input& input, const PositionSnapshot& position, Move& move);
+	void render(sf::RenderWindow& gameWindow, const PositionSnapshot& position);
+
+	int getPlayerColor() const;
 
 private:
 	int playerColor;
 
 	// Manual piece movement
 	int selectedIndex;
-	std::vector<Move> selectedPieceMoves;
-
-	// Highlighted
-	std::vector<int> mostRecentMove;
 
 	// Drawing related members
 	int tileSize;
@@ -41,14 +41,14 @@ private:
 
 
 	// User input
-	void movePieceManually(const Input& input, Engine& engine);
+	bool movePieceManually(const Input& input, const PositionSnapshot& position, Move& move);
 
 	// Draw functions
 	void drawTiles(sf::RenderWindow& gameWindow);
-	void drawMostRecentMove(sf::RenderWindow& gameWindow);
+	void drawMostRecentMove(sf::RenderWindow& gameWindow, const PositionSnapshot& position);
 	void drawSelectedOutline(sf::RenderWindow& gameWindow);
-	void drawPieces(sf::RenderWindow& gameWindow, const Engine& engine);
-	void drawSelectedPieceMoves(sf::RenderWindow& gameWindow);
+	void drawPieces(sf::RenderWindow& gameWindow, const PositionSnapshot& position);
+	void drawSelectedPieceMoves(sf::RenderWindow& gameWindow, const PositionSnapshot& position);
 
 	// Utility
 	std::vector<int> rotateBoard(const std::vector<int>& board);
@@ -0,0 +1,44 @@
+#pragma once
+
+class Engine;
+
+/*
+* Responsible for endgames the general evaluation gets wrong.
+* Evaluation functions replace the evaluation entirely and return a score from the strong side's point of view.
+* Scaling functions return a factor out of SCALE_NORMAL that is applied to the endgame score of the side ahead.
+* The material table decides which of these applies, so they are only looked up when the material changes.
+*/
+class Endgame
+{
+public:
+	typedef int (*EvaluationFunction)(const Engine& position, int strongSide);
+	typedef int (*ScalingFunction)(const Engine& position, int strongSide);
+
+	// Well above any material balance, well below mate scores
+	static const int KNOWN_WIN = 10000;
+	static const int SCALE_NORMAL = 64;
+
+	// KRK, KQK and any other mating material against a bare king: drive the king to the edge.
+	// Bishops that are all on one colour cannot mate, so that is a draw.
+	static int evaluateKXK(const Engine& position, int strongSide);
+
+	// KBNK: drive the king to a corner the bishop can cover
+	static int evaluateKBNK(const Engine& position, int strongSide);
+
+	// KPK: rule of the square and key squares
+	static int evaluateKPK(const Engine& position, int strongSide);
+
+	// Bishops on opposite colours with only pawns besides are very drawish
+	static int scaleOppositeBishops(const Engine& position, int strongSide);
+
+	// A side with no pawns and at most a minor piece cannot win
+	static int scaleInsufficientMaterial(const Engine& position, int strongSide);
+
+private:
+	static int getFile(int square);
+	static int getRank(int square);
+	static int getDistance(int a, int b);
+
+	// Larger the closer the square is to the edge of the board
+	static int getEdgeBonus(int square);
+};
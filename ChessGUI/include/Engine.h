@@ -1,8 +1,15 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
+#include <memory>
 #include <Bitboard.h>
 #include <Move.h>
+#include <PawnTable.h>
+#include <MaterialTable.h>
+#include <Nnue.h>
+#include <PositionSnapshot.h>
+#include <PackedPosition.h>
 
 
 class Engine 
@@ -22,24 +29,177 @@ public:
 
 	Engine();
 
-	bool makeMove(Move move);
+	// Plays the move if it is legal. On success the move is filled in as played, with its pieces and promotion.
+	bool makeMove(Move& move);
 
 	const std::vector<int>& getBoard() const;
+	const std::vector<Bitboard>& getPiecePositions() const; // Indexed by piece - 1
 	bool isSquareEmpty(int index);
-	int getTurn();
+	int getTurn() const;
 
-	void loadFen(const std::string& fen);
+	// Loads a position from FEN. The move counters are optional, so EPD positions load too.
+	// Does not allocate. On invalid input the position is left as it was and error, if given, says why.
+	bool loadFen(std::string_view fen, std::string* error = nullptr);
+
+	// Writes the position as FEN. writeFen does not allocate; the buffer must hold MAX_FEN_LENGTH characters.
+	// The en passant square is only written when a pawn can take on it.
+	std::string toFen() const;
+	size_t writeFen(char* buffer) const;
+	static const int MAX_FEN_LENGTH = 128;
+	static const std::string startingFen;
+
+	// Binary form for datasets. encode leaves the score, result and best move empty, and fails if there are
+	// more than 32 pieces. decode checks the position like loadFen and leaves it as it was if it is invalid.
+	bool encode(PackedPosition& packed) const;
+	bool decode(const PackedPosition& packed, std::string* error = nullptr);
+
+	// Moves in long algebraic notation as used by UCI, e.g. e2e4, e1g1, e7e8q
+	static std::string moveToString(const Move& move);
+	static std::string squareToString(int index);
+	// Fills in the legal move matching the string. Returns false if there is none.
+	bool parseMove(const std::string& str, Move& move);
+
+	// Moves in standard algebraic notation as used by PGN and EPD, e.g. Nf3, exd5, O-O, e8=Q+
+	std::string moveToSan(const Move& move);
+
+	// Fills in the move by working back from the target square to the pieces that can reach it, without
+	// generating every move. Only moves that more than one piece could make are checked for legality,
+	// so it is fast enough to replay game collections, but it trusts the notation otherwise.
+	bool parseSan(std::string_view san, Move& move);
+
+	// En passant captures leave the target square empty, so this checks the piece that moved too
+	static bool isCapture(const Move& move);
+
+	// Material the move wins outright: the captured piece plus what a promotion adds
+	static int getMoveGain(const Move& move);
+
+	// Copies the game position for the GUI. The last move is the last one played through makeMove.
+	void writeSnapshot(PositionSnapshot& snapshot);
 
 	// Single Piece Move Generation (to highlight possible moves for the player)
 	std::vector<Move> getPieceMoves(int origin);
 
+	// Search interface
+	// Moves passed in must come from getLegalMoves, which fills in the piece info
+	void getLegalMoves(std::vector<Move>& moves);
+	void getLegalCaptures(std::vector<Move>& moves); // Captures and queen promotions
+	void makePseudoLegalMove(Move move);
+	void undoMove(const Move& move);
+	void makeNullMove();
+	void undoNullMove();
+	bool isInCheck(int color);
+	bool isSquareAttacked(int index, int byColor);
+	bool isRepetition() const;
+	int getHalfmoveClock() const; // Plies since the last capture or pawn move
+	bool canCastle(int color, bool kingSide) const;
+	int getEnPassantSquare() const; // -1 unless a pawn can take en passant
+	uint64_t getHashKey() const;
+	uint64_t getPawnKey() const;
+	uint64_t getMaterialKey() const;
+
+	// Number of knights, bishops, rooks and queens, used to spot zugzwang-prone endgames
+	int getNonPawnPieceCount(int color) const;
+
+	// Whether the enemy queen reaches a square next to the king of color that only the king defends, the usual
+	// start of a mating attack. The search does not prune on the static evaluation then.
+	bool isThreatened(int color) const;
+
+	// Static evaluation from the point of view of the side to move.
+	// The search passes its own tables so pawn structure is only evaluated when the pawns change,
+	// and special endgames are only recognised when the material changes.
+	int evaluate();
+	int evaluate(PawnTable& pawnTable, MaterialTable& materialTable);
+
+	// Once a network is set it replaces the handcrafted evaluation. Copies of the engine share the network.
+	void setNetwork(std::shared_ptr<const Nnue> newNetwork);
+
+	// Value in centipawns of a piece as stored on the board (either color)
+	static int getPieceValue(int piece);
+
+	// Static Exchange Evaluation: material won by the side making the capture if both sides keep recapturing
+	// on the target square with their least valuable piece. Allocation-free, so it can be called on every capture.
+	// A promotion gains the promoted piece, which is what can be recaptured; later recaptures are taken not to promote.
+	int see(const Move& move) const;
+	bool seeGE(const Move& move, int threshold) const;
+
 private:
 	// Board state
 	std::vector<int> board;
 	std::vector<Bitboard> piecePositions;
-	std::vector<bool> castlingRights; // {WQ, WK, BQ, BK}
+	int castlingRights; // CASTLE_* flags
 	Bitboard enPassantTarget;
+	int halfmoveClock;
+	int fullmoveNumber;
 	int turn;
+	Move lastMove; // Only set by makeMove, not by the search
+
+	// Castling rights
+	static const int CASTLE_WQ = 1;
+	static const int CASTLE_WK = 2;
+	static const int CASTLE_BQ = 4;
+	static const int CASTLE_BK = 8;
+
+	// Rights that survive a move from or to each square, e.g. anything touching e1 loses both white rights
+	static const int castlingMasks[64];
+
+	// State a move cannot be undone without, saved by every make and restored by every undo
+	struct UndoState
+	{
+		int castlingRights;
+		Bitboard enPassantTarget;
+		int halfmoveClock;
+	};
+	std::vector<UndoState> undoHistory;
+
+	// Zobrist hash of the position, and of every position before it for repetition detection
+	uint64_t hashKey;
+	std::vector<uint64_t> hashHistory;
+
+	// Zobrist hash of the pawns only, used to index the pawn table
+	uint64_t pawnKey;
+
+	// Hash of the number of pieces of each kind, used to index the material table.
+	// The n-th piece of a kind adds zobristMaterialKeys[piece - 1][n - 1].
+	uint64_t materialKey;
+	static uint64_t zobristMaterialKeys[12][16];
+
+	// Zobrist keys, shared by all engines
+	static uint64_t zobristPieceKeys[12][64];
+	static uint64_t zobristTurnKey;
+	static uint64_t zobristCastlingKeys[16];
+	static uint64_t zobristEnPassantKeys[8]; // By file
+	static void initZobristKeys();
+
+	// Tapered material and piece-square score from white's point of view. The game phase comes from the material table.
+	int mgScore;
+	int egScore;
+
+	// Tapered score from the side to move's point of view, with the pawn structure terms added in
+	int getTaperedScore(const PawnTable::Entry& pawns, const MaterialTable::Entry& material);
+
+	// Network evaluation. There is one accumulator per move played so undoing a move is a pop.
+	std::shared_ptr<const Nnue> network;
+	std::vector<Nnue::Accumulator> accumulators;
+	void refreshAccumulators();
+	void pushAccumulator(const Move& move);
+
+	// Every change to the board goes through these, which keep the hash and evaluation terms up to date
+	void addPiece(int piece, int index);
+	void removePiece(int piece, int index);
+	void setCastlingRights(int rights);
+	void setEnPassantTarget(const Bitboard& target);
+
+	// Position setup shared by loadFen and decode. The check returns what is wrong, or nullptr.
+	// pieces is indexed by square, like board.
+	static const char* checkPosition(const int* pieces, int sideToMove, int enPassantSquare);
+	void setPosition(const int* pieces, int sideToMove, int rights, int enPassantSquare, int newHalfmoveClock, int newFullmoveNumber);
+
+	// Rook squares of a castling move, from the king's target square
+	static void getCastlingRookSquares(int kingTarget, int& rookOrigin, int& rookTarget);
+
+	// Piece values in centipawns, indexed by piece
+	static const int pieceValues[7];
+	static const int seeValues[7]; // The king is worth more than anything it could capture
 
 	// Attack tables
 	std::vector<std::vector<Bitboard>> pawnAttackMasks;
@@ -47,9 +207,6 @@ private:
 	std::vector<Bitboard> kingAttackMasks;
 	std::vector<std::vector<Bitboard>> rayTable;
 
-	// Preset positions
-	static const std::string startingFen;
-
 	// Directions
 	static const int NORTH = 0;
 	static const int NORTH_EAST = 1;
@@ -74,10 +231,6 @@ private:
 	Bitboard genRay(int index, int dir);
 	void fillRayTable();
 
-	// Change board state
-	void undoMove(const Move& move);
-	void makePseudoLegalMove(Move move);
-
 	// Generates all Moves for a type of piece (pseudo-legal)
 	void getPawnMoves(Bitboard pawnPositions, int color, const Bitboard& empty, const Bitboard& oppColorPieces, std::vector<Move>& moves);
 	void getKnightMoves(Bitboard knightPositions, const Bitboard& sameColorPieces, std::vector<Move>& moves);
@@ -85,9 +238,14 @@ private:
 	void getBishopMoves(Bitboard bishopPositions, const Bitboard& blockers, const Bitboard& sameColorPieces, std::vector<Move>& moves);
 	void getRookMoves(Bitboard rookPositions, const Bitboard& blockers, const Bitboard& sameColorPieces, std::vector<Move>& moves);
 	void getQueenMoves(Bitboard queenPosition, const Bitboard& blockers, const Bitboard& sameColorPieces, std::vector<Move>& moves);
+	void getCastlingMoves(int color, const Bitboard& occupied, std::vector<Move>& moves);
+
+	// Generates all Moves for the side to move (pseudo-legal)
+	void genMovesForTurn(bool capturesOnly, std::vector<Move>& moves);
 
 	// Pseudo-legal to legal
 	void filterOutIllegalMoves(int color, std::vector<Move>& pseudoLegalMoves, std::vector<Move>& legalMoves);
+	void removeIllegalMoves(std::vector<Move>& moves);
 
 	// Generates the Bitboard of moves for all pieces of the same type (pseudo-legal)
 	Bitboard genPawnsMoveMask(int color, Bitboard pawnPositions, const Bitboard& empty, const Bitboard& oppColorPieces);
@@ -99,17 +257,18 @@ private:
 	Bitboard genPawnMoveMask(int originIdx, int color, Bitboard currPawn, const Bitboard& empty, const Bitboard& oppColorPieces);
 	Bitboard genKnightMoveMask(int originIdx, const Bitboard& sameColorPieces);
 	Bitboard genKingMoveMask(Bitboard kingPosition, const Bitboard& sameColorPieces);
-	Bitboard genBishopMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces);
-	Bitboard genRookMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces);
+	Bitboard genBishopMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces) const;
+	Bitboard genRookMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces) const;
 	Bitboard genQueenMoveMask(Bitboard queenPosition, const Bitboard& blockers, const Bitboard& sameColorPieces);
 
 	Bitboard genAttackMask(int color);
 
-	bool isInCheck(int color);
+	// Attack lookups used by SEE and check detection
+	Bitboard getAttackersTo(int index, const Bitboard& occupied) const;
+	Bitboard genSliderAttacks(int index, const Bitboard& occupied, const Bitboard& diagonalSliders, const Bitboard& straightSliders) const;
+	Bitboard getLeastValuableAttacker(const Bitboard& attackers, int color, int& piece) const;
 
 	// Utility
-	Bitboard getOccupancyByColor(int color);
-	Bitboard getOccupiedSquares();
-	Bitboard getBitboardFromAlg(const std::string&);
-	
+	Bitboard getOccupancyByColor(int color) const;
+	Bitboard getOccupiedSquares() const;
 };
\ No newline at end of file
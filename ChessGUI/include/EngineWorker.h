@@ -0,0 +1,90 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <Engine.h>
+#include <Move.h>
+#include <Search.h>
+#include <SpscQueue.h>
+
+/*
+* Responsible for running the search on its own thread so the game loop never waits for it.
+* Commands go in through a queue the worker sleeps on; results come back through a lock-free queue
+* that the game loop polls once per frame.
+*/
+class EngineWorker
+{
+public:
+	struct Result
+	{
+		static const int INFO = 0;
+		static const int BEST_MOVE = 1;
+
+		Result() : type(INFO), searchId(0), score(0) {}
+		int type;
+		int searchId; // As returned by go(), so results of an abandoned search can be told apart
+		Search::Info info; // For INFO: one completed iteration
+		Move bestMove; // For BEST_MOVE: a null move if there was no legal move
+		Move ponderMove; // For BEST_MOVE: the expected reply, a null move if the PV was too short
+		int score;
+	};
+
+	EngineWorker();
+	~EngineWorker();
+
+	EngineWorker(const EngineWorker&) = delete;
+	EngineWorker& operator=(const EngineWorker&) = delete;
+
+	// Commands, all of which return immediately
+	void setPosition(const Engine& position);
+	int go(const Search::Limits& limits);
+
+	// The running search posts its best move as soon as it finishes; searches still queued are dropped without a result
+	void stop();
+
+	// The move a ponder search assumed was played, so it now runs on the clock
+	void ponderHit();
+
+	// Called from the game loop. Returns false once there are no more results waiting.
+	bool pollResult(Result& result);
+
+private:
+	struct Command
+	{
+		static const int SET_POSITION = 0;
+		static const int GO = 1;
+		static const int QUIT = 2;
+
+		int type;
+		Engine position;
+		Search::Limits limits;
+		int searchId;
+	};
+
+	// Only touched by the worker thread while it runs
+	Search search;
+	Engine position;
+	std::vector<Move> lastPv;
+	int currentSearchId;
+
+	// Only touched by the game loop
+	int nextSearchId;
+
+	std::mutex mutex;
+	std::condition_variable commandAvailable;
+	std::deque<Command> commands;
+	bool searching;
+
+	SpscQueue<Result, 256> results;
+	std::atomic<bool> quitting; // Set by the destructor
+
+	std::thread thread;
+
+	void pushCommand(const Command& command);
+	void run();
+
+	// Info is dropped if the game loop falls behind, the best move only once the worker is being destroyed
+	void postResult(const Result& result, bool mustDeliver);
+};
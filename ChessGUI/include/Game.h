@@ -4,6 +4,8 @@
 #include <Input.h>
 #include <Board.h>
 #include <Engine.h>
+#include <EngineWorker.h>
+#include <SnapshotBuffer.h>
 
 /*
 * Responbile for top-level management of the application.
@@ -39,4 +41,26 @@ private:
 	Input input;
 	Board board;
 	Engine engine;
+
+	// Board only sees the game through these, published after every move
+	SnapshotBuffer snapshots;
+	void publishSnapshot();
+
+	// The opponent searches on its own thread; the game loop only polls for its move
+	EngineWorker engineWorker;
+	bool engineThinking;
+	int engineSearchId; // Results from any other search are stale
+	static const int ENGINE_MOVE_TIME = 1000; // Milliseconds
+
+	// While the player thinks the engine searches the reply it expects. If the player makes it the search
+	// carries on, otherwise it is abandoned and the transposition table it filled is still there for the real one.
+	bool pondering;
+	Move ponderMove;
+	bool ponderResultReady; // The ponder search finished before the player moved
+	EngineWorker::Result ponderResult;
+
+	void startEngineSearch();
+	void startPondering(const Move& expectedMove);
+	void playEngineMove(EngineWorker::Result& result);
+	void pollEngine();
 };
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+
+/*
+* Responsible for mapping a file into memory read-only.
+* The pages are loaded by the operating system on first access and shared between processes,
+* so large tables can be used in place without reading or copying them.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false if the file does not exist, is empty or cannot be mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const;
+	const unsigned char* getData() const;
+	size_t getSize() const;
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
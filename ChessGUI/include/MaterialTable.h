@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <Bitboard.h>
+#include <Endgame.h>
+
+/*
+* Responsible for everything in the evaluation that only depends on how many pieces of each kind are on the board.
+* Entries are keyed by the engine's material key, which changes only on captures and promotions,
+* so recognising special endgames costs nothing on the vast majority of evaluations.
+* Each search thread owns its own table, so no synchronisation is needed.
+*/
+class MaterialTable
+{
+public:
+	struct Entry
+	{
+		Entry() : key(0), phase(0), imbalanceMg(0), imbalanceEg(0), strongSide(0), evaluate(nullptr), scale{ nullptr, nullptr } {}
+		uint64_t key;
+		int phase;
+		int imbalanceMg; // From white's point of view
+		int imbalanceEg;
+
+		// Replaces the evaluation when set
+		int strongSide;
+		Endgame::EvaluationFunction evaluate;
+
+		// Applied to the endgame score when that side is ahead, indexed by color
+		Endgame::ScalingFunction scale[2];
+	};
+
+	MaterialTable(size_t entries = 8192);
+
+	void clear();
+
+	// Returns the entry for this material, computing it on a miss. pieces is indexed like Engine::piecePositions.
+	const Entry& probe(uint64_t materialKey, const std::vector<Bitboard>& pieces);
+
+	static void evaluate(const std::vector<Bitboard>& pieces, Entry& entry);
+
+private:
+	std::vector<Entry> entries;
+	size_t mask;
+
+	// Imbalance terms in centipawns
+	static const int BISHOP_PAIR_MG = 30;
+	static const int BISHOP_PAIR_EG = 50;
+	static const int KNIGHT_PAWN_ADJUSTMENT = 4; // Knights get better with more pawns on the board
+	static const int ROOK_PAWN_ADJUSTMENT = -8; // and rooks worse
+
+	static void findEndgame(const int counts[12], int color, Entry& entry);
+};
@@ -1,9 +1,21 @@
 #pragma once
+#include <stdint.h>
+
 struct Move
 {
-	Move(int o, int t) : originIndex(o), targetIndex(t) {}
+	Move() : originIndex(0), originPiece(0), targetIndex(0), targetPiece(0), promotion(0) {}
+	Move(int o, int t, int p = 0) : originIndex(o), originPiece(0), targetIndex(t), targetPiece(0), promotion(p) {}
 	int originIndex;
 	int originPiece;
 	int targetIndex;
 	int targetPiece;
-};
\ No newline at end of file
+	int promotion; // Piece type a pawn promotes to, without color. 0 if not a promotion.
+
+	// Two moves are the same if they go from and to the same squares and promote to the same piece
+	bool operator==(const Move& rhs) const { return originIndex == rhs.originIndex && targetIndex == rhs.targetIndex && promotion == rhs.promotion; }
+	bool operator!=(const Move& rhs) const { return !(*this == rhs); }
+
+	// Compact form for tables: origin in the low 6 bits, target in the next 6, promotion in the 3 above
+	uint16_t pack() const { return (uint16_t)(originIndex | (targetIndex << 6) | (promotion << 12)); }
+	static Move unpack(uint16_t packed) { return Move(packed & 63, (packed >> 6) & 63, (packed >> 12) & 7); }
+};
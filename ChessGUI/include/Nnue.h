@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <Bitboard.h>
+#include <MappedFile.h>
+
+/*
+* Responsible for the efficiently updatable neural network evaluation.
+* Inputs are HalfKP features: (king square, piece, square) for every non-king piece, seen from each side.
+* The feature transformer output is kept in an accumulator by the engine and updated as pieces move,
+* so only the small layers after it run on every evaluation.
+*
+* Network file layout, little endian, every section starting on a 64 byte boundary:
+*   header          "CBNN", uint32 version, padded to 64 bytes
+*   ft biases       int16[L1]
+*   ft weights      int16[INPUTS][L1]
+*   hidden1 biases  int32[L2]
+*   hidden1 weights int8[L2][2 * L1]
+*   hidden2 biases  int32[L3]
+*   hidden2 weights int8[L3][L2]
+*   output bias     int32, padded to 64 bytes
+*   output weights  int8[L3]
+*/
+class Nnue
+{
+public:
+	static const int INPUTS = 64 * 640;
+	static const int L1 = 256;
+	static const int L2 = 32;
+	static const int L3 = 32;
+
+	// Quantisation: activations are clipped to [0, 127], hidden weights are scaled by 64
+	// and the output is scaled by 16 to give centipawns
+	static const int WEIGHT_SHIFT = 6;
+	static const int OUTPUT_SCALE = 16;
+
+	static const uint32_t VERSION = 1;
+
+	// Feature transformer output for both perspectives, indexed by color
+	struct Accumulator
+	{
+		int16_t values[2][L1];
+	};
+
+	Nnue();
+
+	// The weights are used straight from the mapped file, so the network must be loaded before use
+	bool load(const std::string& path);
+	bool isLoaded() const;
+
+	// Recomputes one perspective from scratch. pieces is indexed like Engine::piecePositions.
+	void refresh(Accumulator& accumulator, int perspective, const std::vector<Bitboard>& pieces) const;
+
+	// Applies a piece moving from one square to another, and optionally a piece removed, to one perspective.
+	// Pass -1 for unused squares.
+	void update(Accumulator& accumulator, int perspective, int kingSquare, int piece, int from, int to, int removedPiece, int removedSquare) const;
+
+	// Evaluation in centipawns from the point of view of the side to move
+	int evaluate(const Accumulator& accumulator, int sideToMove) const;
+
+	static int getFeatureIndex(int perspective, int kingSquare, int piece, int square);
+
+private:
+	MappedFile file;
+
+	const int16_t* ftBiases;
+	const int16_t* ftWeights;
+	const int32_t* hidden1Biases;
+	const int8_t* hidden1Weights;
+	const int32_t* hidden2Biases;
+	const int8_t* hidden2Weights;
+	const int32_t* outputBias;
+	const int8_t* outputWeights;
+
+	static void addFeature(int16_t* values, const int16_t* weights);
+	static void subFeature(int16_t* values, const int16_t* weights);
+
+	// Clipped ReLU from int16 or int32 to uint8
+	static void clipAccumulator(const int16_t* input, uint8_t* output);
+	static void clipHidden(const int32_t* input, uint8_t* output, int size);
+
+	// output = biases + weights * input, with uint8 inputs and int8 weights
+	static void affine(const uint8_t* input, int inputSize, const int8_t* weights, const int32_t* biases, int32_t* output, int outputSize);
+	static int32_t dot(const uint8_t* input, const int8_t* weights, int size);
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <Move.h>
+#include <MappedFile.h>
+
+class Engine;
+
+/*
+* Responsible for looking up positions in a Polyglot opening book.
+* The book is mapped and searched in place: a .bin file is a list of 16 byte big-endian entries
+* (key, move, weight, learn) sorted by key, so a lookup is a binary search over the mapped pages
+* and never reads the file. The key is Polyglot's own Zobrist hash, not the engine's.
+*/
+class OpeningBook
+{
+public:
+	struct Entry
+	{
+		Move move; // Filled in like a move from getLegalMoves
+		int weight;
+	};
+
+	OpeningBook();
+
+	// Returns false if the file cannot be mapped or is not a whole number of entries
+	bool load(const std::string& path);
+	void close();
+	bool isLoaded() const;
+	size_t getEntryCount() const;
+
+	// Book moves for the position, skipping any that are not legal in it
+	void getMoves(Engine& position, std::vector<Entry>& moves) const;
+
+	// Picks one of the book moves with a probability proportional to its weight.
+	// random is any uniformly distributed number. Returns false if the position is not in the book.
+	bool pickMove(Engine& position, uint64_t random, Move& move) const;
+
+	static uint64_t getKey(const Engine& position);
+
+	// Polyglot form of a move from getLegalMoves, for writing books
+	static uint16_t encodeMove(const Move& move);
+
+private:
+	static const size_t ENTRY_SIZE = 16;
+
+	MappedFile file;
+	size_t entryCount;
+
+	// Fields of the entry at an index, read from the big-endian file
+	uint64_t getEntryKey(size_t index) const;
+	uint16_t getEntryMove(size_t index) const;
+	uint16_t getEntryWeight(size_t index) const;
+
+	// Polyglot moves go from file and row to file and row, and castling is the king taking its own rook
+	static Move decodeMove(uint16_t bookMove, const Engine& position);
+
+	// 768 piece-square keys, then 4 castling, 8 en passant file and 1 side to move key
+	static const uint64_t randomKeys[781];
+	static const int CASTLING_KEYS = 768;
+	static const int EN_PASSANT_KEYS = 772;
+	static const int TURN_KEY = 780;
+};
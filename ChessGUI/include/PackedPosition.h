@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+/*
+* Responsible for holding a position in 32 bytes, for datasets of millions of positions.
+* Records are written to files as they are, so the layout is fixed: no padding, little-endian fields.
+* Fill in with Engine::encode and read back with Engine::decode. The fullmove number is not kept.
+*/
+struct PackedPosition
+{
+	// Results, from white's point of view
+	static const uint8_t RESULT_UNKNOWN = 0;
+	static const uint8_t RESULT_WHITE_WIN = 1;
+	static const uint8_t RESULT_DRAW = 2;
+	static const uint8_t RESULT_BLACK_WIN = 3;
+
+	static const int16_t NO_SCORE = -32768;
+
+	uint64_t occupancy; // Same square indices as Engine
+	uint8_t pieces[16]; // Engine piece codes of the occupied squares from the lowest index up, two per byte, low nibble first
+	uint8_t sideAndCastling; // Side to move in bit 0, Engine castling rights in bits 1 to 4
+	uint8_t enPassant; // Square behind a pawn that can be taken en passant, 0 for none (it can never be square 0)
+	uint8_t halfmoveClock; // Capped at 255
+	uint8_t result;
+
+	// Optional, filled in by whoever writes the record
+	int16_t score; // Centipawns from the side to move's point of view, NO_SCORE if there is none
+	uint16_t bestMove; // Move::pack, 0 if there is none
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition records are 32 bytes");
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <Bitboard.h>
+
+/*
+* Responsible for evaluating pawn structure and caching the result by pawn-only hash key.
+* Pawns rarely move compared to other pieces, so nearly every probe during a search is a hit.
+* Each search thread owns its own table, so no synchronisation is needed.
+*/
+class PawnTable
+{
+public:
+	struct Entry
+	{
+		Entry() : key(0), mgScore(0), egScore(0) {}
+		uint64_t key;
+		int mgScore; // From white's point of view
+		int egScore;
+	};
+
+	PawnTable(size_t entries = 16384);
+
+	void clear();
+
+	// Returns the entry for this pawn structure, evaluating it on a miss
+	const Entry& probe(uint64_t pawnKey, const Bitboard& whitePawns, const Bitboard& blackPawns);
+
+	// Set-wise evaluation of passed, isolated, doubled and backward pawns
+	static void evaluate(const Bitboard& whitePawns, const Bitboard& blackPawns, Entry& entry);
+
+	// Pawns in front of the king, only counted in the middlegame as they matter less once queens are off
+	static int evaluateShield(const Bitboard& kingPosition, const Bitboard& pawns, int color);
+
+	// Probe counters, reset at the start of every search
+	uint64_t getProbes() const;
+	uint64_t getHits() const;
+	void resetStats();
+
+private:
+	std::vector<Entry> entries;
+	size_t mask;
+	uint64_t probes;
+	uint64_t hits;
+
+	// Bonuses and penalties in centipawns
+	static const int passedMg[8]; // Indexed by rank relative to the pawn's side
+	static const int passedEg[8];
+	static const int ISOLATED_MG = -10;
+	static const int ISOLATED_EG = -15;
+	static const int DOUBLED_MG = -10;
+	static const int DOUBLED_EG = -20;
+	static const int BACKWARD_MG = -8;
+	static const int BACKWARD_EG = -10;
+	static const int SHIELD_NEAR = 15;
+	static const int SHIELD_FAR = 8;
+
+	// Sums the passed pawn bonus of every pawn by relative rank
+	static void scorePassedPawns(Bitboard passed, int color, int& mg, int& eg);
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+* Responsible for the tapered material and piece-square values used by the evaluation.
+* Values include the material of the piece and are from white's point of view,
+* so a black piece's entry is the negated value of its mirrored white square.
+*/
+class PieceSquareTable
+{
+public:
+	// Indexed by piece as stored on the board minus one, then board index
+	static int mg[12][64];
+	static int eg[12][64];
+
+	// Game phase contributed by each piece type, indexed by piece. A full board adds up to MAX_PHASE.
+	static const int phaseWeights[7];
+	static const int MAX_PHASE = 24;
+
+	static void init();
+
+private:
+	// Tables are written rank 8 to rank 1 and file a to h, as seen by white
+	static const int mgValues[7];
+	static const int egValues[7];
+	static const int mgTables[7][64];
+	static const int egTables[7][64];
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <Bitboard.h>
+#include <Move.h>
+
+/*
+* Responsible for holding everything the GUI needs to draw the game position.
+* A plain copy taken after each move, so it can be read while the engine works on its own positions.
+*/
+struct PositionSnapshot
+{
+	PositionSnapshot() : board(), hasLastMove(false), turn(0) {}
+
+	int board[64]; // Same layout as Engine::getBoard
+	Move lastMove;
+	bool hasLastMove;
+	int turn;
+
+	// Target squares of the legal moves of the side to move, indexed by origin square
+	Bitboard legalTargets[64];
+};
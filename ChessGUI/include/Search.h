@@ -0,0 +1,172 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <Engine.h>
+#include <Move.h>
+#include <TranspositionTable.h>
+#include <TimeManager.h>
+#include <Tablebases.h>
+
+class SearchThread;
+
+/*
+* Responsible for running a search over a copy of an engine position.
+* Uses Lazy SMP: every thread searches the root position on its own copy of the board,
+* and the threads only share work through the transposition table.
+* Thread 0 is the main thread; it runs on the caller's thread, checks the limits and reports results.
+*/
+class Search
+{
+public:
+	static const int MAX_PLY = 64;
+	static const int MATE_SCORE = 30000;
+	static const int INFINITE_SCORE = 31000;
+	static const int TB_WIN_SCORE = MATE_SCORE - 2 * MAX_PLY; // A win the tablebases know of, below any mate the search finds
+
+	struct Limits
+	{
+		Limits() : depth(MAX_PLY - 1), nodes(0), time(0), increment(0), movesToGo(0), moveTime(0), ponder(false), multiPv(1) {}
+		int depth;
+		uint64_t nodes; // 0 for no limit
+
+		// Clock of the side to move in milliseconds, 0 for no clock. See TimeManager.
+		int64_t time;
+		int64_t increment;
+		int movesToGo;
+		int64_t moveTime;
+
+		// Searching on the opponent's time, on the position after the move they are expected to play.
+		// The clock only starts to matter after ponderHit(), but the time spent before then counts.
+		bool ponder;
+
+		// Number of best root moves to find, each with its own score and PV
+		int multiPv;
+	};
+
+	// Selective search techniques, each of which can be switched off to measure its effect
+	struct Options
+	{
+		Options() : nullMove(true), lateMoveReductions(true), lateMovePruning(true), seePruning(true), reverseFutility(true), futility(true), razoring(true), aspirationWindow(25) {}
+		bool nullMove;
+		bool lateMoveReductions;
+		bool lateMovePruning;
+		bool seePruning; // Captures that lose too much in the exchange, near the leaves
+		bool reverseFutility;
+		bool futility;
+		bool razoring;
+		int aspirationWindow; // Initial half-width in centipawns, 0 to always search the full window
+	};
+
+	// Counters summed over all threads
+	struct Stats
+	{
+		Stats() : cutoffs(0), firstMoveCutoffs(0), qnodes(0), pvsResearches(0), lmrResearches(0), aspirationFailLows(0), aspirationFailHighs(0), pawnProbes(0), pawnHits(0), tbHits(0) {}
+		uint64_t cutoffs;
+		uint64_t firstMoveCutoffs;
+		uint64_t qnodes; // Nodes visited by quiescence search, included in the total node count
+
+		// Re-searches: null window searches that beat alpha, and root searches that fell outside the aspiration window
+		uint64_t pvsResearches;
+		uint64_t lmrResearches;
+		uint64_t aspirationFailLows;
+		uint64_t aspirationFailHighs;
+
+		uint64_t pawnProbes;
+		uint64_t pawnHits;
+		uint64_t tbHits;
+
+		// Percentage of beta cutoffs caused by the first move searched, a measure of move ordering quality
+		double firstMoveCutoffRate() const;
+		double pawnHitRate() const;
+		Stats& operator+=(const Stats& rhs);
+	};
+
+	// Reported by the main thread after every completed iteration, once for each MultiPV line
+	struct Info
+	{
+		int depth;
+		int multiPv; // 1 for the best line
+		int score;
+		uint64_t nodes;
+		int64_t timeMs;
+		std::vector<Move> pv;
+	};
+
+	// One of the best root moves, with the line that follows it
+	struct Line
+	{
+		int score;
+		std::vector<Move> pv;
+	};
+
+	struct Result
+	{
+		Move bestMove;
+		int score;
+		int depth;
+		uint64_t nodes;
+		Stats stats;
+		std::vector<Line> lines; // Best first, as many as Limits::multiPv and the legal moves allow
+	};
+
+	Search();
+	~Search();
+
+	void setThreads(int count);
+	int getThreads() const;
+	void setHashSize(size_t megabytes);
+	void clearHash();
+	void setInfoCallback(std::function<void(const Info&)> callback);
+
+	// Only takes effect from the next call to go()
+	void setOptions(const Options& newOptions);
+	const Options& getOptions() const;
+
+	// Endgame tablebases, which can be shared with anything else probing them. nullptr for none.
+	void setTablebases(std::shared_ptr<Tablebases> newTablebases);
+
+	// Clears the stop and ponder hit of the last search. Call it before every go(), while holding whatever lock guards
+	// the caller's own record that a search is running: a stop() made before then is meant for the old search,
+	// and one made after it reaches the new one even while go() is starting up.
+	void prepare();
+
+	// Blocks until the limits are reached or stop() is called from another thread
+	Result go(const Engine& position, const Limits& limits);
+	void stop();
+
+	// The expected move was played, so a ponder search becomes a normal one. The same rule as for stop() applies.
+	void ponderHit();
+
+private:
+	friend class SearchThread;
+
+	TranspositionTable tt;
+	std::vector<std::unique_ptr<SearchThread>> threads;
+	std::atomic<bool> stopped;
+
+	// Set by ponderHit(). stopOnPonderHit is set by the main thread when the time was already used up while pondering.
+	std::atomic<bool> ponderHitReceived;
+	std::atomic<bool> stopOnPonderHit;
+	bool isPondering() const;
+	Limits limits;
+	Options options;
+	std::chrono::steady_clock::time_point startTime;
+	TimeManager timeManager;
+	std::function<void(const Info&)> infoCallback;
+
+	// Set by go(). With the root in the tablebases only the moves that keep its result are searched,
+	// and once DTZ has ranked them the search has no need to probe. Empty to search every move.
+	std::shared_ptr<Tablebases> tablebases;
+	std::vector<Move> tablebaseRootMoves;
+	bool probeTablebases;
+
+	uint64_t getNodes() const;
+	int64_t getElapsedMs() const;
+
+	// Polled by the main thread every few thousand nodes, so the clock is not read on every node
+	void checkLimits();
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <Engine.h>
+#include <Move.h>
+#include <Search.h>
+#include <PawnTable.h>
+#include <MaterialTable.h>
+
+/*
+* Responsible for one thread of a Lazy SMP search.
+* Owns its own copy of the position and its own search stack, so nothing here is shared between threads.
+*/
+class SearchThread
+{
+public:
+	SearchThread(Search& search, int id);
+
+	void setPosition(const Engine& position);
+
+	// Searches with increasing depth until the depth limit is reached or the search is stopped
+	void iterativeDeepening();
+
+	uint64_t getNodes() const;
+
+	// Results of the last completed iteration
+	Move bestMove;
+	int bestScore;
+	int completedDepth;
+	std::vector<Move> pv;
+	std::vector<Search::Line> lines; // Best first, lines[0] is bestMove with pv
+
+	// Read by the search once this thread has finished
+	Search::Stats stats;
+
+private:
+	// Per ply buffers so move generation does not allocate once warmed up
+	struct StackEntry
+	{
+		std::vector<Move> moves;
+		std::vector<int> moveScores;
+		std::vector<Move> quietsTried;
+		Move currentMove;
+	};
+
+	Search& search;
+	const int id;
+	Engine position;
+	std::atomic<uint64_t> nodes;
+	PawnTable pawnTable;
+	MaterialTable materialTable;
+
+	StackEntry stack[Search::MAX_PLY + 1];
+	Move pvTable[Search::MAX_PLY + 1][Search::MAX_PLY + 1];
+	int pvLength[Search::MAX_PLY + 1];
+
+	// Nodes spent below the current best root move, used to tell how clearly it dominates
+	uint64_t bestMoveNodes;
+
+	// Root moves already taken by earlier MultiPV lines of this iteration, skipped by the root search along with
+	// any the tablebases rule out.
+	// There are only a handful, so a linear scan at the root is cheaper than anything cleverer.
+	std::vector<Move> excludedRootMoves;
+	std::vector<Search::Line> iterationLines;
+	Move rootMoveHint; // This line's move from the last iteration, searched first as the TT move belongs to the first line
+	bool isExcludedRootMove(const Move& move) const;
+
+	// Move ordering tables. Moves are packed and scores are 16 bits so everything stays in cache.
+	uint16_t killers[Search::MAX_PLY + 1][2];
+	int16_t history[2][64][64]; // [color][origin][target]
+	uint16_t counterMoves[12][64]; // [piece][target] of the previous move
+	static const int MAX_HISTORY = 16384;
+
+	// Helper threads add noise to move ordering so they explore different parts of the tree
+	uint64_t randomState;
+
+	int negamax(int depth, int ply, int alpha, int beta, bool pvNode);
+
+	// Selective search
+	// Reverse futility margin grows faster than the depth, as deeper searches have more time for the evaluation to drop
+	static const int REVERSE_FUTILITY_DEPTH = 5;
+	static const int REVERSE_FUTILITY_MARGIN = 60;
+	static const int REVERSE_FUTILITY_GROWTH = 10;
+	static const int RAZOR_MARGIN = 300;
+	static const int FUTILITY_MARGIN = 150;
+	static const int SEE_PRUNE_MARGIN = 100;
+	static const int NULL_MOVE_VERIFICATION_DEPTH = 6;
+	int nullMoveMinPly; // Null moves are not tried above this ply while verifying
+	static int lmrTable[64][64]; // [depth][move number]
+	static void initLmrTable();
+
+	// Searches captures only until the position is quiet, so leaves are not evaluated in the middle of an exchange
+	int quiescence(int ply, int alpha, int beta);
+	static const int DELTA_MARGIN = 200;
+
+	// Move ordering
+	void scoreMoves(int ply, const Move& ttMove);
+	const Move& pickNextMove(int ply, size_t index);
+	void updateQuietStats(int ply, int depth, const Move& move);
+	void updateHistory(int color, const Move& move, int bonus);
+	void resetOrderingTables();
+
+	// Helper threads skip some depths so that they do not all search the same iteration
+	bool skipDepth(int depth) const;
+
+	void countNode();
+	void updatePv(int ply, const Move& move);
+	bool isStopped() const;
+	uint64_t nextRandom();
+
+	// Mate and tablebase scores are stored relative to the node rather than to the root
+	static int scoreToTT(int score, int ply);
+	static int scoreFromTT(int score, int ply);
+};
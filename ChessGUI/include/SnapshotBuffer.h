@@ -0,0 +1,28 @@
+#pragma once
+#include <atomic>
+#include <PositionSnapshot.h>
+
+/*
+* Responsible for handing position snapshots from one writer to one reader without locks.
+* The writer fills the back buffer and publishes it with an atomic swap. The reader marks the buffer it is using,
+* and the writer waits before reusing that buffer, so the reader never waits and never sees a half written snapshot.
+*/
+class SnapshotBuffer
+{
+public:
+	SnapshotBuffer();
+
+	// Writer side: fill the returned snapshot, then publish it
+	PositionSnapshot& beginWrite();
+	void publish();
+
+	// Reader side: the snapshot stays valid and unchanged until release
+	const PositionSnapshot& acquire();
+	void release();
+
+private:
+	PositionSnapshot buffers[2];
+	std::atomic<int> front;
+	std::atomic<int> inUse; // Buffer held by the reader, -1 if none
+	int back;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+
+/*
+* Responsible for passing items from exactly one producer thread to exactly one consumer thread without locks.
+* A fixed ring buffer: the producer only writes tail and the consumer only writes head,
+* so each side only has to see the other's index, which acquire/release ordering guarantees.
+*/
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	// Producer side. Returns false if the queue is full.
+	bool push(const T& item)
+	{
+		const size_t currentTail = tail.load(std::memory_order_relaxed);
+		const size_t nextTail = (currentTail + 1) % Capacity;
+		if (nextTail == head.load(std::memory_order_acquire)) return false;
+
+		items[currentTail] = item;
+		tail.store(nextTail, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false if the queue is empty.
+	bool pop(T& item)
+	{
+		const size_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire)) return false;
+
+		item = std::move(items[currentHead]);
+		head.store((currentHead + 1) % Capacity, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items[Capacity];
+
+	// On separate cache lines so the two threads do not keep invalidating each other's index
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+};
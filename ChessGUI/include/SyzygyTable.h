@@ -0,0 +1,123 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <MappedFile.h>
+
+class Engine;
+
+/*
+* Responsible for decoding one Syzygy tablebase file, either the WDL (.rtbw) or the DTZ (.rtbz) table of one material.
+* A position is turned into an index by placing its pieces in the order the generator chose for the table,
+* with the board mirrored so the leading piece is in a canonical corner. The value at the index is decompressed
+* from the block of Huffman coded, recursively paired symbols that holds it, straight from the mapped file.
+* Pieces and squares here follow the tablebase format: a1 is 0, pawn to king are 1 to 6 and black adds 8.
+*/
+class SyzygyTable
+{
+public:
+	static const int WDL = 0;
+	static const int DTZ = 1;
+
+	static const int MAX_PIECES = 7;
+
+	// counts[color][piece] of the stronger side, white, and the weaker side, black, as named by the file
+	SyzygyTable(int type, const std::string& path, const int counts[2][7]);
+
+	SyzygyTable(const SyzygyTable&) = delete;
+	SyzygyTable& operator=(const SyzygyTable&) = delete;
+
+	// Maps and parses the file. Returns false if it cannot be mapped or is not a table of the expected kind.
+	bool map();
+	void unmap();
+	bool isMapped() const;
+
+	// Value of the position, which must have the material of the table and be mapped.
+	// WDL tables give -2 to 2 as in Tablebases. A DTZ table needs the WDL value and gives plies to a zeroing move,
+	// unless it only stores the other side to move, in which case changeSide is set.
+	int probe(const Engine& position, int wdl, bool& changeSide) const;
+
+	// Material keys with the stronger side as white and as black. They are the same for symmetric tables.
+	uint64_t getKey() const;
+	uint64_t getMirroredKey() const;
+	int getPieceCount() const;
+
+	// Parses the material part of a file name like KRPvKR. Returns false if it is not one.
+	static bool parseName(const std::string& name, int counts[2][7]);
+	static uint64_t getMaterialKey(const int counts[2][7]);
+	static uint64_t getMaterialKey(const Engine& position);
+
+private:
+	// Flags of a block of pairs data
+	static const int FLAG_STM = 1;
+	static const int FLAG_MAPPED = 2;
+	static const int FLAG_WIN_PLIES = 4;
+	static const int FLAG_LOSS_PLIES = 8;
+	static const int FLAG_WIDE = 16;
+	static const int FLAG_SINGLE_VALUE = 128;
+
+	// Compressed values of one side to move and, with pawns, one file of the leading pawn
+	struct PairsData
+	{
+		int flags;
+		size_t blockSize;
+		size_t span; // There is a sparse index entry about every span values
+		uint32_t blockCount;
+		int maxSymbolLength;
+		int minSymbolLength; // The value itself for a single value table
+		const unsigned char* lowestSymbols; // Lowest symbol of each length, 16 bits each
+		const unsigned char* symbolTree; // The two symbols each symbol expands to, 12 bits each
+		const unsigned char* blockLengths; // Values in each block minus one, 16 bits each
+		uint32_t blockLengthCount;
+		const unsigned char* sparseIndex; // 32 bit block and 16 bit offset entries
+		size_t sparseIndexSize;
+		const unsigned char* data;
+		std::vector<uint64_t> base; // Lowest symbol of each length, left aligned to 64 bits
+		std::vector<uint8_t> symbolLengths; // Values each symbol stands for, minus one
+		int pieces[MAX_PIECES]; // Order the pieces are encoded in, which defines the groups
+		uint64_t groupIndex[MAX_PIECES + 1];
+		int groupLength[MAX_PIECES + 1]; // Zero terminated
+		uint16_t mapIndex[4]; // DTZ value maps for win, loss, cursed win and blessed loss
+	};
+
+	const int type;
+	const std::string path;
+	MappedFile file;
+	bool mapped;
+
+	uint64_t key;
+	uint64_t mirroredKey;
+	int pieceCount;
+	bool hasPawns;
+	bool hasUniquePieces;
+	int pawnCounts[2]; // Leading color first
+	const unsigned char* dtzMap;
+	PairsData items[2][4]; // [side to move][file of the leading pawn]
+
+	PairsData& getPairs(int side, int file);
+	const PairsData& getPairs(int side, int file) const;
+
+	// Parsing, in file order
+	bool parse(const unsigned char* data, const unsigned char* end);
+	void setGroups(PairsData& pairs, const int order[2], int file);
+	const unsigned char* setSizes(PairsData& pairs, const unsigned char* data);
+	uint8_t setSymbolLength(PairsData& pairs, int symbol, std::vector<bool>& visited);
+
+	int decompress(const PairsData& pairs, uint64_t index) const;
+	int mapScore(int file, int value, int wdl) const;
+
+	static int getLeftSymbol(const PairsData& pairs, int symbol);
+	static int getRightSymbol(const PairsData& pairs, int symbol);
+
+	// Encoding tables shared by every table
+	static int mapPawns[64];
+	static int mapB1H1H7[64];
+	static int mapA1D1D4[64];
+	static int mapKK[10][64];
+	static uint64_t binomial[6][64]; // [k][n], ways to choose k of n
+	static int leadPawnIndex[6][64]; // [lead pawn count][square]
+	static int leadPawnsSize[6][4]; // [lead pawn count][file]
+	static void initEncodingTables();
+	static int offDiagonal(int square); // Above the a1-h8 diagonal if positive, below if negative
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <Move.h>
+#include <SyzygyTable.h>
+
+class Engine;
+
+/*
+* Responsible for probing Syzygy endgame tablebases kept in local directories.
+* The files are found when the directories are set but only mapped when first probed, and only so many stay mapped:
+* the least recently used one is unmapped to make room. Any number of search threads can probe at once.
+* WDL tables give the result under the fifty move rule. DTZ tables give the plies to the next capture or pawn move
+* on the way to it, which is what root moves are ranked by.
+*/
+class Tablebases
+{
+public:
+	// Results, from the point of view of the side to move
+	static const int LOSS = -2;
+	static const int BLESSED_LOSS = -1; // Lost, but saved by the fifty move rule
+	static const int DRAW = 0;
+	static const int CURSED_WIN = 1; // Won, but only after the fifty move rule has drawn it
+	static const int WIN = 2;
+
+	static const int DEFAULT_MAX_MAPPED = 128;
+
+	Tablebases();
+
+	Tablebases(const Tablebases&) = delete;
+	Tablebases& operator=(const Tablebases&) = delete;
+
+	// Directories separated by ';' on Windows and ':' elsewhere. Replaces any tables found before, so it must not be
+	// called while anything is probing. Returns the number of table files found.
+	int load(const std::string& paths);
+	int getTableCount() const;
+	int getMaxPieces() const; // 0 without tables
+
+	// Files mapped at once. Tables being probed are never unmapped, so there can briefly be more.
+	void setMaxMapped(int count);
+
+	// Tables do not hold positions with castling rights
+	bool canProbe(const Engine& position) const;
+
+	// Both return false if a table they need is missing or broken. The position is left as it was.
+	bool probeWdl(Engine& position, int& wdl);
+	bool probeDtz(Engine& position, int& dtz);
+
+	// Keeps the root moves that do best by the tables: any win that is certain within the fifty move rule, otherwise
+	// the quickest win, the draws or the slowest loss. Ranks by DTZ, or by WDL if that fails or disagrees with WDL,
+	// and says which in usedDtz. Returns false and leaves the moves as they were if WDL fails or contradicts itself.
+	bool filterRootMoves(Engine& position, std::vector<Move>& moves, bool& usedDtz);
+
+private:
+	// A file and how it is being used. The counters are guarded by the mutex.
+	struct Slot
+	{
+		Slot() : users(0), lastUsed(0), broken(false) {}
+		std::unique_ptr<SyzygyTable> table;
+		int users;
+		uint64_t lastUsed;
+		bool broken; // Could not be mapped, so it is not tried again
+	};
+
+	struct Material
+	{
+		Slot wdl;
+		Slot dtz;
+	};
+
+	std::vector<std::unique_ptr<Material>> materials;
+	std::unordered_map<uint64_t, Material*> materialsByKey; // By both material keys of the table
+	int tableCount;
+	int maxPieces;
+
+	std::mutex mutex;
+	std::vector<Slot*> mappedSlots;
+	size_t maxMapped;
+	uint64_t useCounter;
+
+	// Maps the table if needed and holds it until release. Returns nullptr if there is no usable table.
+	SyzygyTable* acquire(Slot& slot);
+	void release(Slot& slot);
+
+	// How a probe went. Tables leave out positions where a capture or pawn move is best, so such a result comes
+	// from a search instead. DTZ tables only hold one side to move, and the other is probed a ply deeper.
+	static const int PROBE_FAIL = 0;
+	static const int PROBE_OK = 1;
+	static const int PROBE_ZEROING_BEST = 2;
+	static const int PROBE_CHANGE_SIDE = 3;
+
+	int probeTable(Engine& position, int type, int wdl, int& state);
+	int searchZeroing(Engine& position, bool pawnMoves, int& state);
+	int getWdl(Engine& position, int& state);
+	int getDtz(Engine& position, int& state);
+
+	// Ranks of root moves. Certain wins rank the same, and losses too unless the fifty move rule could save them.
+	static const int MAX_DTZ = 1 << 18;
+	bool rankByDtz(Engine& position, const std::vector<Move>& moves, std::vector<int>& ranks);
+	bool rankByWdl(Engine& position, const std::vector<Move>& moves, std::vector<int>& ranks, bool& ruleDraws);
+
+	// DTZ of the position before a zeroing move with the result that follows it
+	static int dtzBeforeZeroing(int wdl);
+	static int countPieces(const Engine& position);
+	static int getSign(int value);
+
+	// After a root move that repeats or reaches the fifty move limit the game is drawn, whatever the tables say.
+	// Tables assume neither, so root moves are checked first.
+	static bool isDrawnByRule(Engine& position);
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <Move.h>
+
+/*
+* Responsible for deciding how long to think on a move when playing with a clock.
+* The soft limit is the time to aim for; it is stretched while the best move keeps changing or the score is falling,
+* and shrunk when one move clearly dominates. The hard limit is never exceeded and is checked during the search.
+*/
+class TimeManager
+{
+public:
+	TimeManager();
+
+	// All times in milliseconds. time and increment are for the side to move, movesToGo is 0 for sudden death.
+	// A moveTime other than 0 searches for exactly that long instead.
+	void start(int64_t time, int64_t increment, int movesToGo, int64_t moveTime);
+	void disable();
+
+	bool isEnabled() const;
+	int64_t getSoftLimit() const;
+	int64_t getHardLimit() const;
+
+	// Called after each completed iteration. bestMoveEffort is the fraction of that iteration's nodes spent on the best move.
+	// Returns true if there is not enough time left to make another iteration worthwhile.
+	bool shouldStop(int depth, const Move& bestMove, int score, double bestMoveEffort, int64_t elapsedMs);
+
+	bool isHardLimitReached(int64_t elapsedMs) const;
+
+private:
+	bool enabled;
+	bool fixedTime;
+	int64_t softLimit;
+	int64_t hardLimit;
+
+	Move lastBestMove;
+	int lastScore;
+	double instability; // Decaying count of best move changes
+
+	// Time kept back for communication and the GUI
+	static const int64_t MOVE_OVERHEAD = 30;
+
+	// Moves assumed to be left in sudden death
+	static const int DEFAULT_MOVES_TO_GO = 40;
+};
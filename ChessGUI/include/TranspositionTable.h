@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <Move.h>
+
+/*
+* Responsible for storing search results by position hash.
+* The table is shared between search threads without locks: every entry stores its key XORed with its data,
+* so an entry torn by two threads writing at once no longer matches its key and is ignored.
+*/
+class TranspositionTable
+{
+public:
+	// Bound types
+	static const int BOUND_NONE = 0;
+	static const int BOUND_EXACT = 1;
+	static const int BOUND_LOWER = 2;
+	static const int BOUND_UPPER = 3;
+
+	struct Data
+	{
+		Move move;
+		int score;
+		int depth;
+		int bound;
+	};
+
+	TranspositionTable(size_t megabytes);
+
+	void resize(size_t megabytes);
+	void clear();
+
+	// Called once per search so that old entries get replaced first
+	void newSearch();
+
+	bool probe(uint64_t key, Data& data) const;
+	void store(uint64_t key, int depth, int score, int bound, const Move& move);
+
+	// Permill of entries written during the current search
+	int hashfull() const;
+
+private:
+	struct Entry
+	{
+		std::atomic<uint64_t> key;
+		std::atomic<uint64_t> data;
+	};
+
+	// Four entries fill a cache line. Buckets are aligned to one so a probe touches a single line.
+	static const int BUCKET_SIZE = 4;
+	struct alignas(64) Bucket
+	{
+		Entry entries[BUCKET_SIZE];
+	};
+	static_assert(sizeof(Bucket) == 64, "A bucket must fill exactly one cache line");
+
+	std::unique_ptr<Bucket[]> buckets;
+	size_t bucketCount;
+	uint8_t generation;
+
+	// Data layout: move (16 bits) | score (16 bits) | depth (8 bits) | bound (2 bits) | generation (8 bits)
+	static uint64_t pack(int depth, int score, int bound, const Move& move, uint8_t generation);
+	static void unpack(uint64_t data, Data& out);
+	static int getDepth(uint64_t data);
+	static uint8_t getGeneration(uint64_t data);
+
+	Bucket& getBucket(uint64_t key) const;
+};
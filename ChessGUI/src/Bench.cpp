@@ -0,0 +1,260 @@
+#include "Bench.h"
+#include "Engine.h"
+#include "Search.h"
+#include <chrono>
+#include <iomanip>
+
+const std::vector<std::string> Bench::positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "r1bq1rk1/pp2bppp/2n1pn2/2pp4/3P4/2PBPN2/PP1N1PPP/R2QK2R w KQ - 0 8",
+    "r2q1rk1/1b2bppp/p2ppn2/1p6/3NP3/1BN1Q3/PPP2PPP/R4RK1 w - - 0 13",
+    "8/5pk1/6p1/3R3p/7P/6P1/r4PK1/8 w - - 0 40",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+};
+
+double Bench::getPercent(uint64_t part, uint64_t whole)
+{
+    return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+void Bench::search(std::ostream& out, int depth)
+{
+    out << "Search to depth " << depth << std::endl;
+    out << std::setw(4) << "pos" << std::setw(12) << "time (ms)" << std::setw(14) << "nodes"
+        << std::setw(10) << "qnodes %" << std::setw(12) << "cutoffs" << std::setw(14) << "first move %"
+        << std::setw(10) << "pvs re" << std::setw(10) << "lmr re" << std::setw(10) << "asp low" << std::setw(10) << "asp high" << std::setw(12) << "pawn hit %" << std::endl;
+
+    Engine engine;
+    Search search;
+    Search::Limits limits;
+    limits.depth = depth;
+
+    int64_t totalMs = 0;
+    uint64_t totalNodes = 0;
+    Search::Stats totalStats;
+    for (size_t i = 0; i != positions.size(); ++i)
+    {
+        search.clearHash();
+        engine.loadFen(positions[i]);
+
+        search.prepare();
+        const auto start = std::chrono::steady_clock::now();
+        const Search::Result result = search.go(engine, limits);
+        const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        totalMs += ms;
+        totalNodes += result.nodes;
+        totalStats += result.stats;
+
+        printSearchRow(out, std::to_string(i + 1), ms, result.nodes, result.stats);
+    }
+
+    printSearchRow(out, "all", totalMs, totalNodes, totalStats);
+}
+
+void Bench::printSearchRow(std::ostream& out, const std::string& label, int64_t ms, uint64_t nodes, const Search::Stats& stats)
+{
+    out << std::setw(4) << label << std::setw(12) << ms << std::setw(14) << nodes
+        << std::setw(10) << std::fixed << std::setprecision(1) << getPercent(stats.qnodes, nodes)
+        << std::setw(12) << stats.cutoffs << std::setw(14) << std::fixed << std::setprecision(1) << stats.firstMoveCutoffRate()
+        << std::setw(10) << stats.pvsResearches << std::setw(10) << stats.lmrResearches
+        << std::setw(10) << stats.aspirationFailLows << std::setw(10) << stats.aspirationFailHighs
+        << std::setw(12) << std::fixed << std::setprecision(1) << stats.pawnHitRate() << std::endl;
+}
+
+void Bench::aspiration(std::ostream& out, int depth)
+{
+    const int windows[] = { 0, 10, 15, 25, 35, 50, 100 };
+
+    out << "Aspiration windows, depth " << depth << " over " << positions.size() << " positions" << std::endl;
+    out << std::setw(8) << "window" << std::setw(12) << "time (ms)" << std::setw(14) << "nodes"
+        << std::setw(10) << "asp low" << std::setw(10) << "asp high" << std::setw(10) << "pvs re" << std::endl;
+
+    for (int window : windows)
+    {
+        Search search;
+        Search::Options options;
+        options.aspirationWindow = window;
+        search.setOptions(options);
+
+        int64_t totalMs = 0;
+        Search::Stats stats;
+        const uint64_t nodes = searchAll(search, depth, totalMs, stats);
+
+        out << std::setw(8) << window << std::setw(12) << totalMs << std::setw(14) << nodes
+            << std::setw(10) << stats.aspirationFailLows << std::setw(10) << stats.aspirationFailHighs << std::setw(10) << stats.pvsResearches << std::endl;
+    }
+}
+
+uint64_t Bench::searchAll(Search& search, int depth, int64_t& totalMs, Search::Stats& totalStats, std::shared_ptr<const Nnue> network, int multiPv)
+{
+    Engine engine;
+    engine.setNetwork(network);
+    Search::Limits limits;
+    limits.depth = depth;
+    limits.multiPv = multiPv;
+
+    uint64_t totalNodes = 0;
+    for (const std::string& fen : positions)
+    {
+        search.clearHash();
+        engine.loadFen(fen);
+
+        search.prepare();
+        const auto start = std::chrono::steady_clock::now();
+        const Search::Result result = search.go(engine, limits);
+        totalMs += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        totalNodes += result.nodes;
+        totalStats += result.stats;
+    }
+    return totalNodes;
+}
+
+void Bench::pruning(std::ostream& out, int depth)
+{
+    struct Variant
+    {
+        const char* name;
+        bool Search::Options::* option;
+    };
+    const Variant variants[] = {
+        { "all on", nullptr },
+        { "no null move", &Search::Options::nullMove },
+        { "no LMR", &Search::Options::lateMoveReductions },
+        { "no LMP", &Search::Options::lateMovePruning },
+        { "no SEE pruning", &Search::Options::seePruning },
+        { "no reverse futility", &Search::Options::reverseFutility },
+        { "no futility", &Search::Options::futility },
+        { "no razoring", &Search::Options::razoring },
+    };
+
+    out << "Nodes to depth " << depth << " over " << positions.size() << " positions" << std::endl;
+    out << std::setw(22) << "variant" << std::setw(12) << "time (ms)" << std::setw(14) << "nodes" << std::setw(10) << "vs all" << std::endl;
+
+    uint64_t baseNodes = 0;
+    for (const Variant& variant : variants)
+    {
+        Search search;
+        Search::Options options;
+        if (variant.option) options.*variant.option = false;
+        search.setOptions(options);
+
+        int64_t totalMs = 0;
+        Search::Stats stats;
+        const uint64_t nodes = searchAll(search, depth, totalMs, stats);
+        if (!variant.option) baseNodes = nodes;
+
+        out << std::setw(22) << variant.name << std::setw(12) << totalMs << std::setw(14) << nodes
+            << std::setw(10) << std::fixed << std::setprecision(2) << (baseNodes > 0 ? (double)nodes / baseNodes : 0.0) << std::endl;
+    }
+}
+
+void Bench::smpScaling(std::ostream& out, int depth)
+{
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+    out << "Time to depth " << depth << " over " << positions.size() << " positions" << std::endl;
+    out << std::setw(8) << "threads" << std::setw(12) << "time (ms)" << std::setw(10) << "speedup"
+        << std::setw(14) << "nodes" << std::setw(12) << "nps" << std::endl;
+
+    int64_t singleThreadMs = 0;
+    for (int threads : threadCounts)
+    {
+        Search search;
+        search.setThreads(threads);
+        search.setHashSize(64);
+
+        int64_t totalMs = 0;
+        Search::Stats stats;
+        const uint64_t totalNodes = searchAll(search, depth, totalMs, stats);
+
+        if (threads == 1) singleThreadMs = totalMs;
+        const double speedup = totalMs > 0 ? (double)singleThreadMs / totalMs : 0.0;
+        const uint64_t nps = totalMs > 0 ? totalNodes * 1000 / totalMs : 0;
+
+        out << std::setw(8) << threads << std::setw(12) << totalMs << std::setw(10) << std::fixed << std::setprecision(2) << speedup
+            << std::setw(14) << totalNodes << std::setw(12) << nps << std::endl;
+    }
+}
+
+void Bench::multiPv(std::ostream& out, int depth)
+{
+    const int lineCounts[] = { 1, 2, 3, 5 };
+
+    out << "MultiPV to depth " << depth << " over " << positions.size() << " positions" << std::endl;
+    out << std::setw(8) << "lines" << std::setw(12) << "time (ms)" << std::setw(14) << "nodes" << std::setw(10) << "vs 1" << std::endl;
+
+    int64_t singleLineMs = 0;
+    for (int lineCount : lineCounts)
+    {
+        Search search;
+        int64_t totalMs = 0;
+        Search::Stats stats;
+        const uint64_t totalNodes = searchAll(search, depth, totalMs, stats, nullptr, lineCount);
+
+        if (lineCount == 1) singleLineMs = totalMs;
+        out << std::setw(8) << lineCount << std::setw(12) << totalMs << std::setw(14) << totalNodes
+            << std::setw(10) << std::fixed << std::setprecision(2) << (singleLineMs > 0 ? (double)totalMs / singleLineMs : 0.0) << std::endl;
+    }
+}
+
+void Bench::fen(std::ostream& out, int thousands)
+{
+    const int rounds = thousands * 1000;
+    Engine engine;
+    char buffer[Engine::MAX_FEN_LENGTH];
+
+    // Every position is parsed and written back, and has to come back the same
+    int mismatches = 0;
+    for (const std::string& fen : positions)
+    {
+        engine.loadFen(fen);
+        if (std::string(buffer, engine.writeFen(buffer)) != fen) ++mismatches;
+    }
+
+    int64_t loadNs = 0, writeNs = 0;
+    for (int i = 0; i < rounds; ++i)
+    {
+        const std::string& fen = positions[i % positions.size()];
+
+        const auto start = std::chrono::steady_clock::now();
+        engine.loadFen(fen);
+        const auto loaded = std::chrono::steady_clock::now();
+        engine.writeFen(buffer);
+        const auto written = std::chrono::steady_clock::now();
+
+        loadNs += std::chrono::duration_cast<std::chrono::nanoseconds>(loaded - start).count();
+        writeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(written - loaded).count();
+    }
+
+    out << "FEN round trips of " << positions.size() << " positions, " << mismatches << " mismatched" << std::endl;
+    out << std::setw(8) << "step" << std::setw(12) << "time (ms)" << std::setw(14) << "per second" << std::endl;
+    out << std::setw(8) << "load" << std::setw(12) << loadNs / 1000000 << std::setw(14) << (loadNs > 0 ? rounds * 1000000000LL / loadNs : 0) << std::endl;
+    out << std::setw(8) << "write" << std::setw(12) << writeNs / 1000000 << std::setw(14) << (writeNs > 0 ? rounds * 1000000000LL / writeNs : 0) << std::endl;
+}
+
+void Bench::nnue(std::ostream& out, const std::string& networkPath, int depth)
+{
+    std::shared_ptr<Nnue> network = std::make_shared<Nnue>();
+    if (!network->load(networkPath))
+    {
+        out << "Could not load network " << networkPath << std::endl;
+        return;
+    }
+
+    out << "Search to depth " << depth << " over " << positions.size() << " positions" << std::endl;
+    out << std::setw(14) << "evaluation" << std::setw(12) << "time (ms)" << std::setw(14) << "nodes" << std::setw(12) << "nps" << std::endl;
+
+    const char* names[] = { "handcrafted", "network" };
+    for (int i = 0; i != 2; ++i)
+    {
+        Search search;
+        int64_t totalMs = 0;
+        Search::Stats stats;
+        const uint64_t totalNodes = searchAll(search, depth, totalMs, stats, i == 0 ? nullptr : network);
+        const uint64_t nps = totalMs > 0 ? totalNodes * 1000 / totalMs : 0;
+
+        out << std::setw(14) << names[i] << std::setw(12) << totalMs << std::setw(14) << totalNodes << std::setw(12) << nps << std::endl;
+    }
+}
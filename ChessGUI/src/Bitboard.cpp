@@ -19,8 +19,10 @@ const Bitboard Bitboard::aFile(0x8080808080808080);
 const Bitboard Bitboard::gFile(0x0202020202020202);
 const Bitboard Bitboard::bFile(0x4040404040404040);
 
+const Bitboard Bitboard::rank1(0x00000000000000FF);
 const Bitboard Bitboard::rank4(0x00000000FF000000);
 const Bitboard Bitboard::rank5(0x000000FF00000000);
+const Bitboard Bitboard::rank8(0xFF00000000000000);
 
 Bitboard::Bitboard() : bitboard(0) {}
 
@@ -218,6 +220,16 @@ int Bitboard::bitScanReverse() const
 	return Bitboard::debruijnIndex[(bb * Bitboard::debruijn) >> 58];
 }
 
+int Bitboard::popCount() const
+{
+	// SWAR population count
+	uint64_t bb = bitboard;
+	bb = bb - ((bb >> 1) & 0x5555555555555555);
+	bb = (bb & 0x3333333333333333) + ((bb >> 2) & 0x3333333333333333);
+	bb = (bb + (bb >> 4)) & 0x0f0f0f0f0f0f0f0f;
+	return (int)((bb * 0x0101010101010101) >> 56);
+}
+
 Bitboard Bitboard::resetLSB()
 {
 	return bitboard & (bitboard - 1);
@@ -227,3 +239,26 @@ Bitboard Bitboard::isolateLSB()
 {
 	return Bitboard((int64_t)bitboard & (-(int64_t)bitboard));
 }
+
+Bitboard Bitboard::northFill() const
+{
+	uint64_t bb = bitboard;
+	bb |= bb << 8;
+	bb |= bb << 16;
+	bb |= bb << 32;
+	return Bitboard(bb);
+}
+
+Bitboard Bitboard::southFill() const
+{
+	uint64_t bb = bitboard;
+	bb |= bb >> 8;
+	bb |= bb >> 16;
+	bb |= bb >> 32;
+	return Bitboard(bb);
+}
+
+Bitboard Bitboard::fileFill() const
+{
+	return northFill() | southFill();
+}
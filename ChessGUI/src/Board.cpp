@@ -26,28 +26,33 @@ Board::Board(const int& width) : selectedIndex(-1), board(64, 0), tileSize(width
 }
 
 
-void Board::update(const Input& input, Engine& engine)
+bool Board::update(const Input& input, const PositionSnapshot& position, Move& move)
 {
 
-    movePieceManually(input, engine);
+    return movePieceManually(input, position, move);
 }
 
-void Board::render(sf::RenderWindow& gameWindow, const Engine& engine)
+int Board::getPlayerColor() const
+{
+    return playerColor;
+}
+
+void Board::render(sf::RenderWindow& gameWindow, const PositionSnapshot& position)
 {
     drawTiles(gameWindow);
-    drawMostRecentMove(gameWindow);
+    drawMostRecentMove(gameWindow, position);
     drawSelectedOutline(gameWindow);
-    drawSelectedPieceMoves(gameWindow);
-    drawPieces(gameWindow, engine);
+    drawSelectedPieceMoves(gameWindow, position);
+    drawPieces(gameWindow, position);
 }
 
 
-void Board::movePieceManually(const Input& input, Engine& engine)
+bool Board::movePieceManually(const Input& input, const PositionSnapshot& position, Move& move)
 {
 
     int boardX = input.mousePos.x / tileSize;
     int boardY = input.mousePos.y / tileSize;
-    if (boardX < 0 || boardX > 7 || boardY < 0 || boardY > 7) return;
+    if (boardX < 0 || boardX > 7 || boardY < 0 || boardY > 7) return false;
 
     if (playerColor == Engine::WHITE)
     {
@@ -55,28 +60,21 @@ void Board::movePieceManually(const Input& input, Engine& engine)
         boardY = 7 - boardY;
     }
 
-    if (selectedIndex == -1 && input.isMbPressed(sf::Mouse::Button::Left) && !engine.isSquareEmpty(boardX + boardY * 8))
+    if (selectedIndex == -1 && input.isMbPressed(sf::Mouse::Button::Left) && position.board[boardX + boardY * 8] != 0)
     {
         selectedIndex = boardX + boardY * 8;
-        selectedPieceMoves = engine.getPieceMoves(selectedIndex);
     }
     else if (selectedIndex != -1 && input.isMbPressed(sf::Mouse::Button::Left))
     {
         int targetIndex = boardX + boardY * 8;
-        Move move(selectedIndex, targetIndex);
-        
-        if (engine.makeMove(move))
-        {
-            // Every time a move is made, set the highlight squares appropriately
-            mostRecentMove.clear();
-            mostRecentMove.push_back(selectedIndex);
-            mostRecentMove.push_back(targetIndex);
-         };
-
-        // Clear possible moves for selected piece
-        selectedPieceMoves.clear();
+        const bool isLegal = ((position.legalTargets[selectedIndex] >> targetIndex).get() & 1) != 0;
+        if (isLegal) move = Move(selectedIndex, targetIndex);
+
+        // Deselect the piece either way
         selectedIndex = -1;
+        return isLegal;
     }
+    return false;
 }
 
 void Board::drawTiles(sf::RenderWindow& gameWindow)
@@ -92,17 +90,13 @@ void Board::drawTiles(sf::RenderWindow& gameWindow)
         gameWindow.draw(tile);
     }
 }
-void Board::drawPieces(sf::RenderWindow& gameWindow, const Engine& engine)
+void Board::drawPieces(sf::RenderWindow& gameWindow, const PositionSnapshot& position)
 {
     
-    std::vector<int> board;
-    if (playerColor == Engine::WHITE)
-    {
-        board = engine.getBoard();
-    }
-    else
+    std::vector<int> board(position.board, position.board + 64);
+    if (playerColor != Engine::WHITE)
     {
-        board = rotateBoard(engine.getBoard());
+        board = rotateBoard(board);
     }
 
     for (int i = 0; i != 8; ++i)
@@ -123,12 +117,14 @@ void Board::drawPieces(sf::RenderWindow& gameWindow, const Engine& engine)
     }
 }
 
-void Board::drawMostRecentMove(sf::RenderWindow& gameWindow)
+void Board::drawMostRecentMove(sf::RenderWindow& gameWindow, const PositionSnapshot& position)
 {
+    if (!position.hasLastMove) return;
+
     sf::RectangleShape highlight(sf::Vector2f(tileSize, tileSize));
     highlight.setFillColor(mostRecentMoveCol);
 
-    for (const int& i : mostRecentMove)
+    for (const int& i : { position.lastMove.originIndex, position.lastMove.targetIndex })
     {
         const int index = (playerColor == Engine::WHITE) ? 63 - i : i;
         int x = index % 8;
@@ -153,7 +149,7 @@ void Board::drawSelectedOutline(sf::RenderWindow& gameWindow)
     }
 }
 
-void Board::drawSelectedPieceMoves(sf::RenderWindow& gameWindow)
+void Board::drawSelectedPieceMoves(sf::RenderWindow& gameWindow, const PositionSnapshot& position)
 {
     if (selectedIndex != -1)
     {
@@ -161,11 +157,14 @@ void Board::drawSelectedPieceMoves(sf::RenderWindow& gameWindow)
         outline.setFillColor(sf::Color::Transparent);
         outline.setOutlineThickness(-5);
         outline.setOutlineColor(selectedMovesOutlineCol);
-        for (const Move& m : selectedPieceMoves)
+        Bitboard targets = position.legalTargets[selectedIndex];
+        while (targets)
         {
-            const int targetIndex = (playerColor == Engine::WHITE) ? 63 - m.targetIndex : m.targetIndex;
+            const int target = targets.bitScanForward();
+            const int targetIndex = (playerColor == Engine::WHITE) ? 63 - target : target;
             outline.setPosition(sf::Vector2f((targetIndex % 8) * tileSize, (targetIndex / 8 ) * tileSize));
             gameWindow.draw(outline);
+            targets = targets.resetLSB();
         }
     }
 }
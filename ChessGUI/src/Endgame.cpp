@@ -0,0 +1,139 @@
+#include "Endgame.h"
+#include "Engine.h"
+#include <algorithm>
+#include <cstdlib>
+
+int Endgame::getFile(int square)
+{
+    return 7 - square % 8;
+}
+
+int Endgame::getRank(int square)
+{
+    return square / 8;
+}
+
+int Endgame::getDistance(int a, int b)
+{
+    return std::max(std::abs(getFile(a) - getFile(b)), std::abs(getRank(a) - getRank(b)));
+}
+
+int Endgame::getEdgeBonus(int square)
+{
+    const int file = getFile(square);
+    const int rank = getRank(square);
+    const int centerDistance = std::max(3 - file, file - 4) + std::max(3 - rank, rank - 4);
+    return 20 * centerDistance;
+}
+
+int Endgame::evaluateKXK(const Engine& position, int strongSide)
+{
+    const std::vector<Bitboard>& pieces = position.getPiecePositions();
+    const int offset = strongSide == Engine::WHITE ? 0 : 6;
+    const int strongKing = pieces[Engine::KING - 1 + offset].bitScanForward();
+    const int weakKing = pieces[Engine::KING + 5 - offset].bitScanForward();
+
+    int material = 0;
+    for (int piece = Engine::QUEEN; piece <= (int)Engine::PAWN; ++piece)
+    {
+        material += pieces[piece - 1 + offset].popCount() * Engine::getPieceValue(piece);
+    }
+
+    // Bishops alone only mate if they cover both colours. After an under-promotion they may not, and then
+    // it is as drawn as the material scaleInsufficientMaterial covers.
+    const int bishops = pieces[Engine::BISHOP - 1 + offset].popCount();
+    if (bishops * Engine::getPieceValue(Engine::BISHOP) == material)
+    {
+        bool colours[2] = { false, false };
+        for (Bitboard rest = pieces[Engine::BISHOP - 1 + offset]; rest; rest = rest.resetLSB())
+        {
+            const int bishop = rest.bitScanForward();
+            colours[(getFile(bishop) + getRank(bishop)) % 2] = true;
+        }
+        if (!colours[0] || !colours[1]) return 0;
+    }
+
+    // Push the weak king to the edge and bring the strong king next to it
+    return KNOWN_WIN + material + getEdgeBonus(weakKing) + 10 * (7 - getDistance(strongKing, weakKing));
+}
+
+int Endgame::evaluateKBNK(const Engine& position, int strongSide)
+{
+    const std::vector<Bitboard>& pieces = position.getPiecePositions();
+    const int offset = strongSide == Engine::WHITE ? 0 : 6;
+    const int strongKing = pieces[Engine::KING - 1 + offset].bitScanForward();
+    const int weakKing = pieces[Engine::KING + 5 - offset].bitScanForward();
+    const int bishop = pieces[Engine::BISHOP - 1 + offset].bitScanForward();
+
+    // Mate is only possible in the two corners of the bishop's colour; a1 and h8 are dark
+    const bool darkBishop = (getFile(bishop) + getRank(bishop)) % 2 == 0;
+    const int cornerA = darkBishop ? 7 : 63;  // a1 or a8
+    const int cornerB = darkBishop ? 56 : 0;  // h8 or h1
+    const int cornerDistance = std::min(getDistance(weakKing, cornerA), getDistance(weakKing, cornerB));
+
+    return KNOWN_WIN + Engine::getPieceValue(Engine::BISHOP) + Engine::getPieceValue(Engine::KNIGHT)
+        + 40 * (7 - cornerDistance) + getEdgeBonus(weakKing) / 2 + 10 * (7 - getDistance(strongKing, weakKing));
+}
+
+int Endgame::evaluateKPK(const Engine& position, int strongSide)
+{
+    // Flip the board for black so the pawn always moves up
+    const std::vector<Bitboard>& pieces = position.getPiecePositions();
+    const int offset = strongSide == Engine::WHITE ? 0 : 6;
+    const int flip = strongSide == Engine::WHITE ? 0 : 56;
+    const int strongKing = pieces[Engine::KING - 1 + offset].bitScanForward() ^ flip;
+    const int weakKing = pieces[Engine::KING + 5 - offset].bitScanForward() ^ flip;
+    const int pawn = pieces[Engine::PAWN - 1 + offset].bitScanForward() ^ flip;
+
+    const int pawnFile = getFile(pawn);
+    const int pawnRank = getRank(pawn);
+    const int queeningSquare = pawn % 8 + 56;
+    const bool weakToMove = position.getTurn() != strongSide;
+    const int win = KNOWN_WIN + Engine::getPieceValue(Engine::PAWN) + 20 * pawnRank;
+    const int draw = 5 * pawnRank; // Still worth pushing the pawn while looking for a win
+
+    // The weak king wins the pawn if it is next to it and the strong king is not defending it
+    if (weakToMove && getDistance(weakKing, pawn) == 1 && getDistance(strongKing, pawn) > 1) return 0;
+
+    // Rule of the square: the pawn runs unless the strong king is in its way
+    const int pawnDistance = 7 - pawnRank - (pawnRank == 1 ? 1 : 0);
+    const int weakDistance = getDistance(weakKing, queeningSquare) - (weakToMove ? 1 : 0);
+    const bool kingInFront = getFile(strongKing) == pawnFile && getRank(strongKing) > pawnRank;
+    if (weakDistance > pawnDistance && !kingInFront) return win;
+
+    // A rook pawn is a draw once the weak king reaches the corner
+    if (pawnFile == 0 || pawnFile == 7)
+    {
+        if (getDistance(weakKing, queeningSquare) <= 1) return 0;
+        const int keySquare = queeningSquare + (pawnFile == 0 ? -1 : 1) - 8; // b7 or g7
+        return getDistance(strongKing, keySquare) == 0 || getDistance(strongKing, keySquare + 8) == 0 ? win : draw;
+    }
+
+    // Key squares: the strong king wins if it reaches one of the squares in front of the pawn
+    const int keyRankLow = pawnRank <= 3 ? pawnRank + 2 : pawnRank + 1;
+    const int keyRankHigh = std::min(pawnRank + 2, 7);
+    const int kingFile = getFile(strongKing);
+    const int kingRank = getRank(strongKing);
+    if (std::abs(kingFile - pawnFile) <= 1 && kingRank >= keyRankLow && kingRank <= keyRankHigh) return win;
+
+    return draw;
+}
+
+int Endgame::scaleOppositeBishops(const Engine& position, int strongSide)
+{
+    const std::vector<Bitboard>& pieces = position.getPiecePositions();
+    const int whiteBishop = pieces[Engine::BISHOP - 1].bitScanForward();
+    const int blackBishop = pieces[Engine::BISHOP + 5].bitScanForward();
+    const bool oppositeColours = (getFile(whiteBishop) + getRank(whiteBishop)) % 2 != (getFile(blackBishop) + getRank(blackBishop)) % 2;
+    if (!oppositeColours) return SCALE_NORMAL;
+
+    // Even two extra pawns are often not enough
+    const int offset = strongSide == Engine::WHITE ? 0 : 6;
+    const int pawnDifference = pieces[Engine::PAWN - 1 + offset].popCount() - pieces[Engine::PAWN + 5 - offset].popCount();
+    return pawnDifference <= 1 ? SCALE_NORMAL / 4 : SCALE_NORMAL / 2;
+}
+
+int Endgame::scaleInsufficientMaterial(const Engine&, int)
+{
+    return 0;
+}
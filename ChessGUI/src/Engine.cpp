@@ -1,19 +1,58 @@
 #include "Engine.h"
-#include <sstream>
+#include "PieceSquareTable.h"
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <iterator>
+#include <charconv>
+#include <cstdlib>
 
 const std::string Engine::startingFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+const int Engine::pieceValues[7] = { 0, 0, 900, 330, 320, 500, 100 };
+const int Engine::seeValues[7] = { 0, 20000, 900, 330, 320, 500, 100 };
 
-Engine::Engine() : board(64, 0)
+// FEN letters by piece, and pieces by letter with 0 for anything that is not a piece
+static const char fenPieceChars[13] = { ' ', 'K', 'Q', 'B', 'N', 'R', 'P', 'k', 'q', 'b', 'n', 'r', 'p' };
+static const std::array<int, 128> fenPieceCodes = []()
 {
-    loadFen(startingFen);
+    std::array<int, 128> codes{};
+    for (int piece = 1; piece <= 12; ++piece) codes[(unsigned char)fenPieceChars[piece]] = piece;
+    return codes;
+}();
+
+uint64_t Engine::zobristPieceKeys[12][64];
+uint64_t Engine::zobristTurnKey;
+uint64_t Engine::zobristCastlingKeys[16];
+uint64_t Engine::zobristEnPassantKeys[8];
+uint64_t Engine::zobristMaterialKeys[12][16];
+
+// Rank 1 is h1..a1, rank 8 is h8..a8
+const int Engine::castlingMasks[64] = {
+    13, 15, 15, 12, 15, 15, 15, 14,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+     7, 15, 15,  3, 15, 15, 15, 11
+};
+
+
+Engine::Engine() : board(64, 0), piecePositions(12), castlingRights(0), halfmoveClock(0), fullmoveNumber(1), turn(WHITE), hashKey(0), pawnKey(0), materialKey(0), mgScore(0), egScore(0)
+{
+    // Keys and tables are shared, so only generate them once
+    static const bool sharedTablesReady = (initZobristKeys(), PieceSquareTable::init(), true);
+    (void)sharedTablesReady;
 
     precomputePawnAttacks();
     precomputeKnightAttacks();
     precomputeKingAttacks();
     fillRayTable();
+
+    // Needs the pawn attacks to decide whether an en passant square counts
+    loadFen(startingFen);
 }
 
 
@@ -22,41 +61,279 @@ const std::vector<int>& Engine::getBoard() const
     return board;
 }
 
+const std::vector<Bitboard>& Engine::getPiecePositions() const
+{
+    return piecePositions;
+}
+
 bool Engine::isSquareEmpty(int index)
 {
     return board[index] == 0;
 }
 
-int Engine::getTurn()
+int Engine::getTurn() const
 {
     return turn;
 }
 
-bool Engine::makeMove(Move move)
+uint64_t Engine::getHashKey() const
+{
+    return hashKey;
+}
+
+uint64_t Engine::getPawnKey() const
+{
+    return pawnKey;
+}
+
+uint64_t Engine::getMaterialKey() const
+{
+    return materialKey;
+}
+
+int Engine::getHalfmoveClock() const
+{
+    return halfmoveClock;
+}
+
+bool Engine::canCastle(int color, bool kingSide) const
+{
+    const int right = color == WHITE ? (kingSide ? CASTLE_WK : CASTLE_WQ) : (kingSide ? CASTLE_BK : CASTLE_BQ);
+    return (castlingRights & right) != 0;
+}
+
+int Engine::getEnPassantSquare() const
+{
+    return enPassantTarget ? enPassantTarget.bitScanForward() : -1;
+}
+
+bool Engine::isRepetition() const
+{
+    // Positions with the same side to move are two plies apart, and nothing before the last
+    // capture or pawn move can come back
+    const int end = std::max(0, (int)hashHistory.size() - halfmoveClock);
+    for (int i = (int)hashHistory.size() - 2; i >= end; i -= 2)
+    {
+        if (hashHistory[i] == hashKey) return true;
+    }
+    return false;
+}
+
+void Engine::initZobristKeys()
+{
+    // xorshift64* with a fixed seed so keys are the same on every run
+    uint64_t seed = 0x9E3779B97F4A7C15;
+    auto next = [&seed]() {
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+        return seed * 0x2545F4914F6CDD1D;
+    };
+
+    for (int piece = 0; piece != 12; ++piece)
+    for (int idx = 0; idx != 64; ++idx)
+    {
+        zobristPieceKeys[piece][idx] = next();
+    }
+    zobristTurnKey = next();
+
+    for (int piece = 0; piece != 12; ++piece)
+    for (int count = 0; count != 16; ++count)
+    {
+        zobristMaterialKeys[piece][count] = next();
+    }
+
+    // No rights hash to nothing, so a position without them only has piece and turn keys
+    for (int rights = 0; rights != 16; ++rights) zobristCastlingKeys[rights] = rights ? next() : 0;
+    for (int file = 0; file != 8; ++file) zobristEnPassantKeys[file] = next();
+}
+
+int Engine::getPieceValue(int piece)
+{
+    return pieceValues[piece > 6 ? piece - 6 : piece];
+}
+
+bool Engine::isCapture(const Move& move)
+{
+    if (move.targetPiece != 0) return true;
+
+    // A pawn only changes file when it captures
+    return (move.originPiece == PAWN || move.originPiece == PAWN + 6) && move.originIndex % 8 != move.targetIndex % 8;
+}
+
+int Engine::getMoveGain(const Move& move)
+{
+    int gain = move.targetPiece != 0 ? getPieceValue(move.targetPiece) : (isCapture(move) ? pieceValues[PAWN] : 0);
+    if (move.promotion != 0) gain += pieceValues[move.promotion] - pieceValues[PAWN];
+    return gain;
+}
+
+int Engine::evaluate()
+{
+    // Single entry tables, for callers outside the search
+    PawnTable pawnTable(1);
+    MaterialTable materialTable(1);
+    return evaluate(pawnTable, materialTable);
+}
+
+int Engine::evaluate(PawnTable& pawnTable, MaterialTable& materialTable)
+{
+    const MaterialTable::Entry& material = materialTable.probe(materialKey, piecePositions);
+    if (material.evaluate)
+    {
+        const int score = material.evaluate(*this, material.strongSide);
+        return (turn == material.strongSide) ? score : -score;
+    }
+
+    if (network) return network->evaluate(accumulators.back(), turn);
+    return getTaperedScore(pawnTable.probe(pawnKey, piecePositions[PAWN - 1], piecePositions[PAWN + 5]), material);
+}
+
+int Engine::getTaperedScore(const PawnTable::Entry& pawns, const MaterialTable::Entry& material)
+{
+    // Material and piece-square scores are kept up to date by addPiece and removePiece, so this is O(1)
+    int mg = mgScore + pawns.mgScore + material.imbalanceMg;
+    int eg = egScore + pawns.egScore + material.imbalanceEg;
+
+    // Shields depend on where the kings are, so they are not part of the cached pawn entry
+    mg += PawnTable::evaluateShield(piecePositions[KING - 1], piecePositions[PAWN - 1], WHITE);
+    mg -= PawnTable::evaluateShield(piecePositions[KING + 5], piecePositions[PAWN + 5], BLACK);
+
+    // Drawish endgames scale down the score of the side that is ahead
+    const int strongSide = eg > 0 ? WHITE : BLACK;
+    if (material.scale[strongSide]) eg = eg * material.scale[strongSide](*this, strongSide) / Endgame::SCALE_NORMAL;
+
+    const int score = (mg * material.phase + eg * (PieceSquareTable::MAX_PHASE - material.phase)) / PieceSquareTable::MAX_PHASE;
+    return (turn == WHITE) ? score : -score;
+}
+
+void Engine::setNetwork(std::shared_ptr<const Nnue> newNetwork)
+{
+    network = newNetwork;
+    if (network) refreshAccumulators();
+    else accumulators.clear();
+}
+
+void Engine::refreshAccumulators()
+{
+    accumulators.assign(1, Nnue::Accumulator());
+    network->refresh(accumulators.back(), WHITE, piecePositions);
+    network->refresh(accumulators.back(), BLACK, piecePositions);
+}
+
+void Engine::pushAccumulator(const Move& move)
+{
+    // Called after the move is on the board
+    accumulators.push_back(accumulators.back());
+    Nnue::Accumulator& accumulator = accumulators.back();
+
+    // Kings are not features, so a king move only changes the features of its own side, all of them
+    const int color = move.originPiece > 6 ? BLACK : WHITE;
+    const bool kingMove = move.originPiece == KING || move.originPiece == KING + 6;
+    const bool castling = kingMove && std::abs(move.targetIndex - move.originIndex) == 2;
+
+    int capturedPiece = move.targetPiece;
+    int capturedSquare = move.targetPiece != 0 ? move.targetIndex : -1;
+    if (move.targetPiece == 0 && isCapture(move))
+    {
+        capturedPiece = PAWN + (1 - color) * 6;
+        capturedSquare = move.targetIndex + (color == WHITE ? -VERTICAL : VERTICAL);
+    }
+
+    int rookOrigin = -1, rookTarget = -1;
+    if (castling) getCastlingRookSquares(move.targetIndex, rookOrigin, rookTarget);
+
+    for (int perspective = WHITE; perspective <= (int)BLACK; ++perspective)
+    {
+        const int king = perspective == WHITE ? KING : KING + 6;
+        if (move.originPiece == king)
+        {
+            network->refresh(accumulator, perspective, piecePositions);
+            continue;
+        }
+
+        // A promoting pawn leaves the board and the new piece is added separately
+        const int kingSquare = piecePositions[king - 1].bitScanForward();
+        network->update(accumulator, perspective, kingSquare, move.originPiece,
+            kingMove ? -1 : move.originIndex, (kingMove || move.promotion) ? -1 : move.targetIndex, capturedPiece, capturedSquare);
+        if (move.promotion) network->update(accumulator, perspective, kingSquare, move.promotion + color * 6, -1, move.targetIndex, 0, -1);
+        if (castling) network->update(accumulator, perspective, kingSquare, ROOK + color * 6, rookOrigin, rookTarget, 0, -1);
+    }
+}
+
+void Engine::addPiece(int piece, int index)
+{
+    board[index] = piece;
+    piecePositions[piece - 1].setBit(index, 1);
+    hashKey ^= zobristPieceKeys[piece - 1][index];
+    if (piece == PAWN || piece == PAWN + 6) pawnKey ^= zobristPieceKeys[piece - 1][index];
+    mgScore += PieceSquareTable::mg[piece - 1][index];
+    egScore += PieceSquareTable::eg[piece - 1][index];
+    materialKey ^= zobristMaterialKeys[piece - 1][piecePositions[piece - 1].popCount() - 1];
+}
+
+void Engine::removePiece(int piece, int index)
+{
+    board[index] = 0;
+    piecePositions[piece - 1].setBit(index, 0);
+    hashKey ^= zobristPieceKeys[piece - 1][index];
+    if (piece == PAWN || piece == PAWN + 6) pawnKey ^= zobristPieceKeys[piece - 1][index];
+    mgScore -= PieceSquareTable::mg[piece - 1][index];
+    egScore -= PieceSquareTable::eg[piece - 1][index];
+    materialKey ^= zobristMaterialKeys[piece - 1][piecePositions[piece - 1].popCount()];
+}
+
+void Engine::setCastlingRights(int rights)
+{
+    hashKey ^= zobristCastlingKeys[castlingRights] ^ zobristCastlingKeys[rights];
+    castlingRights = rights;
+}
+
+void Engine::setEnPassantTarget(const Bitboard& target)
+{
+    if (enPassantTarget) hashKey ^= zobristEnPassantKeys[enPassantTarget.bitScanForward() % 8];
+    enPassantTarget = target;
+    if (enPassantTarget) hashKey ^= zobristEnPassantKeys[enPassantTarget.bitScanForward() % 8];
+}
+
+void Engine::getCastlingRookSquares(int kingTarget, int& rookOrigin, int& rookTarget)
+{
+    // The king lands on the g or c file, next to where the rook ends up
+    if (kingTarget % 8 == 1)
+    {
+        rookOrigin = kingTarget - 1;
+        rookTarget = kingTarget + 1;
+    }
+    else
+    {
+        rookOrigin = kingTarget + 2;
+        rookTarget = kingTarget - 1;
+    }
+}
+
+bool Engine::makeMove(Move& move)
 {
     // Fill in move info
     move.originPiece = board[move.originIndex];
     move.targetPiece = board[move.targetIndex];
 
-    // Check if valid move
+    // Check if valid move. Promotions are to a queen unless the move asks for something else.
     std::vector<Move> validMoves = getPieceMoves(move.originIndex);
 
     bool foundMove = false;
     for (const Move& m : validMoves)
     {
-        if (move.targetIndex == m.targetIndex) foundMove = true;
+        if (move.targetIndex == m.targetIndex && (move.promotion == 0 || move.promotion == m.promotion))
+        {
+            move = m;
+            foundMove = true;
+            break;
+        }
     }
     if (!foundMove) return false;
 
-    // Update board state
-    int originPiece = move.originPiece;
-    int targetPiece = move.targetPiece;
-    board[move.targetIndex] = originPiece;
-    board[move.originIndex] = 0;
-
-    if (targetPiece != 0) piecePositions[targetPiece - 1].setBit(move.targetIndex, 0);
-    piecePositions[originPiece - 1].setBit(move.originIndex, 0);
-    piecePositions[originPiece - 1].setBit(move.targetIndex, 1);
+    makePseudoLegalMove(move);
+    lastMove = move;
 
     return true;
 
@@ -65,102 +342,347 @@ bool Engine::makeMove(Move move)
 void Engine::undoMove(const Move& move)
 {
     // Doesn't care if move is invalid
-    board[move.originIndex] = move.originPiece;
-    board[move.targetIndex] = move.targetPiece;
+    const int color = move.originPiece > 6 ? BLACK : WHITE;
+    const int piece = move.originPiece - color * 6;
 
-    piecePositions[move.originPiece - 1].setBit(move.originIndex, 1);
-    piecePositions[move.originPiece - 1].setBit(move.targetIndex, 0);
+    removePiece(move.promotion ? move.promotion + color * 6 : move.originPiece, move.targetIndex);
+    addPiece(move.originPiece, move.originIndex);
+    if (move.targetPiece != 0) addPiece(move.targetPiece, move.targetIndex);
+    else if (isCapture(move)) addPiece(PAWN + (1 - color) * 6, move.targetIndex + (color == WHITE ? -VERTICAL : VERTICAL));
 
-    if (move.targetPiece != 0) piecePositions[move.targetPiece - 1].setBit(move.targetIndex, 1);
+    if (piece == KING && std::abs(move.targetIndex - move.originIndex) == 2)
+    {
+        int rookOrigin, rookTarget;
+        getCastlingRookSquares(move.targetIndex, rookOrigin, rookTarget);
+        removePiece(ROOK + color * 6, rookTarget);
+        addPiece(ROOK + color * 6, rookOrigin);
+    }
 
+    const UndoState& state = undoHistory.back();
+    castlingRights = state.castlingRights;
+    enPassantTarget = state.enPassantTarget;
+    halfmoveClock = state.halfmoveClock;
+    undoHistory.pop_back();
+    if (color == BLACK) --fullmoveNumber;
+
+    turn = 1 - turn;
+    hashKey = hashHistory.back();
+    hashHistory.pop_back();
+    if (network) accumulators.pop_back();
 }
 
-void Engine::loadFen(const std::string& fen)
+void Engine::writeSnapshot(PositionSnapshot& snapshot)
 {
-    // Reset boards
-    piecePositions = std::vector<Bitboard>(12);
-    board = std::vector<int>(64, 0);
-
-    // FEN starts with rank 8 -> 1 and a->h
-    // White pieces are uppercase letters
-    std::stringstream fenStream(fen);
+    std::copy(board.begin(), board.end(), snapshot.board);
+    snapshot.lastMove = lastMove;
+    snapshot.hasLastMove = lastMove.originPiece != 0;
+    snapshot.turn = turn;
 
-    // Read piece placement string
-    std::string piecePlacementStr;
-    std::string turnStr;
-    std::string castlingStr;
-    std::string enPassantStr;;
-    fenStream >> piecePlacementStr;
+    std::vector<Move> moves;
+    getLegalMoves(moves);
+    for (Bitboard& targets : snapshot.legalTargets) targets = Bitboard();
+    for (const Move& move : moves) snapshot.legalTargets[move.originIndex].setBit(move.targetIndex, 1);
+}
 
+bool Engine::loadFen(std::string_view fen, std::string* error)
+{
+    // Everything is parsed into locals first, so a bad FEN leaves the position as it was.
+    // The error message is the only thing built on the heap, and only on failure.
+    size_t pos = 0;
+    auto fail = [&](const char* message)
+    {
+        if (error) *error = std::string(message) + " at column " + std::to_string(pos + 1);
+        return false;
+    };
+    auto skipSpaces = [&]() { while (pos < fen.size() && fen[pos] == ' ') ++pos; };
+    auto atFieldEnd = [&]() { return pos == fen.size() || fen[pos] == ' '; };
+
+    // Piece placement, rank 8 -> 1 and a -> h. White pieces are uppercase letters.
+    int pieces[64] = {};
     int x = 7, y = 7;
-    for (const char& c : piecePlacementStr)
+    skipSpaces();
+    for (; !atFieldEnd(); ++pos)
     {
-
+        const char c = fen[pos];
         if (c == '/')
         {
+            if (x != -1) return fail("Rank does not have 8 squares");
+            if (y == 0) return fail("More than 8 ranks");
             x = 7;
             --y;
-            continue;
         }
-
-        if (isdigit(c))
+        else if (c >= '1' && c <= '8')
         {
-            const int numEmptySqrs = c - '0';
-            x -= numEmptySqrs;
+            x -= c - '0';
+            if (x < -1) return fail("Rank has more than 8 squares");
         }
         else
         {
-            int piece = 0;
-            switch (tolower(c)) {
-            case 'k':
-                piece = KING;
-                break;
-            case 'q':
-                piece = QUEEN;
-                break;
-            case 'b':
-                piece = BISHOP;
-                break;
-            case 'n':
-                piece = KNIGHT;
-                break;
-            case 'r':
-                piece = ROOK;
-                break;
-            case 'p':
-                piece = PAWN;
-                break;
-            }
-            int color = (islower(c)) ? 1 : 0;
-            piecePositions[piece + color * 6 - 1].setBit(x + y * 8, 1);
-            board[x + y * 8] = piece + color * 6;
+            const int piece = (unsigned char)c < 128 ? fenPieceCodes[(unsigned char)c] : 0;
+            if (piece == 0) return fail("Unknown piece");
+            if (x < 0) return fail("Rank has more than 8 squares");
+            pieces[x + y * 8] = piece;
             --x;
         }
     }
+    if (y != 0 || x != -1) return fail("Piece placement does not have 8 ranks of 8 squares");
+
+    // Side to move
+    skipSpaces();
+    int newTurn = WHITE;
+    if (pos < fen.size() && fen[pos] == 'w') newTurn = WHITE;
+    else if (pos < fen.size() && fen[pos] == 'b') newTurn = BLACK;
+    else return fail("Side to move must be w or b");
+    ++pos;
+    if (!atFieldEnd()) return fail("Side to move must be w or b");
+
+    // Castling rights
+    skipSpaces();
+    int rights = 0;
+    if (pos < fen.size() && fen[pos] == '-') ++pos;
+    else
+    {
+        const size_t start = pos;
+        for (; !atFieldEnd(); ++pos)
+        {
+            int right = 0;
+            switch (fen[pos])
+            {
+            case 'K': right = CASTLE_WK; break;
+            case 'Q': right = CASTLE_WQ; break;
+            case 'k': right = CASTLE_BK; break;
+            case 'q': right = CASTLE_BQ; break;
+            default: return fail("Unknown castling right");
+            }
+            if (rights & right) return fail("Castling right given twice");
+            rights |= right;
+        }
+        if (pos == start) return fail("Missing castling rights");
+    }
+    if (!atFieldEnd()) return fail("Castling rights must be - or a combination of KQkq");
+
+    // En passant square, behind a pawn the other side just pushed two squares
+    skipSpaces();
+    int enPassantSquare = -1;
+    if (pos < fen.size() && fen[pos] == '-') ++pos;
+    else
+    {
+        if (pos + 1 >= fen.size() || fen[pos] < 'a' || fen[pos] > 'h' || fen[pos + 1] != (newTurn == WHITE ? '6' : '3'))
+            return fail("Invalid en passant square");
+        enPassantSquare = 7 - (fen[pos] - 'a') + (fen[pos + 1] - '1') * 8;
+        pos += 2;
+    }
+    if (!atFieldEnd()) return fail("Invalid en passant square");
+
+    // Checks that need the whole placement are reported at the end of the fields they involve
+    const char* invalid = checkPosition(pieces, newTurn, enPassantSquare);
+    if (invalid != nullptr) return fail(invalid);
+
+    // Move counters are optional
+    int newHalfmoveClock = 0;
+    int newFullmoveNumber = 1;
+    skipSpaces();
+    if (pos < fen.size())
+    {
+        const std::from_chars_result result = std::from_chars(fen.data() + pos, fen.data() + fen.size(), newHalfmoveClock);
+        if (result.ec != std::errc() || newHalfmoveClock < 0) return fail("Invalid halfmove clock");
+        pos = result.ptr - fen.data();
+        if (!atFieldEnd()) return fail("Invalid halfmove clock");
+
+        skipSpaces();
+        if (pos < fen.size())
+        {
+            const std::from_chars_result result = std::from_chars(fen.data() + pos, fen.data() + fen.size(), newFullmoveNumber);
+            if (result.ec != std::errc() || newFullmoveNumber < 1) return fail("Invalid fullmove number");
+            pos = result.ptr - fen.data();
+            if (!atFieldEnd()) return fail("Invalid fullmove number");
+        }
+    }
+    skipSpaces();
+    if (pos != fen.size()) return fail("Unexpected text after the FEN");
+
+    setPosition(pieces, newTurn, rights, enPassantSquare, newHalfmoveClock, newFullmoveNumber);
+    return true;
+}
+
+const char* Engine::checkPosition(const int* pieces, int sideToMove, int enPassantSquare)
+{
+    int kingCounts[2] = { 0, 0 };
+    for (int i = 0; i < 64; ++i)
+    {
+        if (pieces[i] == (int)KING || pieces[i] == (int)KING + 6) ++kingCounts[pieces[i] > 6 ? BLACK : WHITE];
+        if ((pieces[i] == (int)PAWN || pieces[i] == (int)PAWN + 6) && (i < 8 || i >= 56)) return "Pawn on the first or last rank";
+    }
+    if (kingCounts[WHITE] != 1 || kingCounts[BLACK] != 1) return "Each side needs exactly one king";
+
+    // Behind a pawn the other side just pushed two squares
+    if (enPassantSquare >= 0)
+    {
+        if (enPassantSquare / 8 != (sideToMove == WHITE ? 5 : 2)) return "Invalid en passant square";
+        const int pushedPawn = enPassantSquare + (sideToMove == WHITE ? -VERTICAL : VERTICAL);
+        if (pieces[enPassantSquare] != 0 || pieces[pushedPawn] != (int)PAWN + (1 - sideToMove) * 6) return "No pawn has just moved past the en passant square";
+    }
+    return nullptr;
+}
+
+void Engine::setPosition(const int* pieces, int sideToMove, int rights, int enPassantSquare, int newHalfmoveClock, int newFullmoveNumber)
+{
+    // Reset the boards in place
+    std::fill(board.begin(), board.end(), 0);
+    std::fill(piecePositions.begin(), piecePositions.end(), Bitboard());
+    hashKey = 0;
+    pawnKey = 0;
+    materialKey = 0;
+    mgScore = egScore = 0;
+    castlingRights = 0;
+    enPassantTarget = Bitboard();
+
+    for (int i = 0; i < 64; ++i)
+    {
+        if (pieces[i] != 0) addPiece(pieces[i], i);
+    }
+
+    // Rights are only kept while the king and rook are on their squares, like castlingMasks does during the game
+    const int rightSquares[4][2] = { { CASTLE_WQ, 7 }, { CASTLE_WK, 0 }, { CASTLE_BQ, 63 }, { CASTLE_BK, 56 } };
+    for (const auto& rightSquare : rightSquares)
+    {
+        const int color = rightSquare[0] >= CASTLE_BQ ? BLACK : WHITE;
+        if (pieces[3 + color * 56] != (int)KING + color * 6 || pieces[rightSquare[1]] != (int)ROOK + color * 6) rights &= ~rightSquare[0];
+    }
+
+    turn = sideToMove;
+    setCastlingRights(rights);
+
+    // Only kept if a pawn can take, the same as after a double push in makePseudoLegalMove
+    if (enPassantSquare >= 0 && (pawnAttackMasks[1 - turn][enPassantSquare] & piecePositions[PAWN + turn * 6 - 1]))
+    {
+        Bitboard target;
+        target.setBit(enPassantSquare, 1);
+        setEnPassantTarget(target);
+    }
+
+    halfmoveClock = newHalfmoveClock;
+    fullmoveNumber = newFullmoveNumber;
+
+    if (turn == BLACK) hashKey ^= zobristTurnKey;
+    hashHistory.clear();
+    undoHistory.clear();
+    lastMove = Move();
+    if (network) refreshAccumulators();
+}
+
+
+bool Engine::encode(PackedPosition& packed) const
+{
+    const Bitboard occupied = getOccupiedSquares();
+    if (occupied.popCount() > 32) return false;
+
+    packed.occupancy = (uint64_t)occupied.get();
+    std::fill(std::begin(packed.pieces), std::end(packed.pieces), 0);
+    Bitboard squares = occupied;
+    for (int i = 0; squares; ++i)
+    {
+        const int square = squares.bitScanForward();
+        squares = squares.resetLSB();
+        packed.pieces[i / 2] |= (uint8_t)(board[square] << (i % 2 * 4));
+    }
+
+    packed.sideAndCastling = (uint8_t)(turn | castlingRights << 1);
+    packed.enPassant = enPassantTarget ? (uint8_t)enPassantTarget.bitScanForward() : 0;
+    packed.halfmoveClock = (uint8_t)std::min(halfmoveClock, 255);
+    packed.result = PackedPosition::RESULT_UNKNOWN;
+    packed.score = PackedPosition::NO_SCORE;
+    packed.bestMove = 0;
+    return true;
+}
+
+bool Engine::decode(const PackedPosition& packed, std::string* error)
+{
+    auto fail = [error](const char* message)
+    {
+        if (error) *error = message;
+        return false;
+    };
+
+    int pieces[64] = {};
+    Bitboard squares((uint64_t)packed.occupancy);
+    if (squares.popCount() > 32) return fail("More than 32 pieces");
+    for (int i = 0; squares; ++i)
+    {
+        const int square = squares.bitScanForward();
+        squares = squares.resetLSB();
+        pieces[square] = (packed.pieces[i / 2] >> (i % 2 * 4)) & 15;
+        if (pieces[square] < 1 || pieces[square] > 12) return fail("Unknown piece");
+    }
 
-    fenStream >> turnStr;
-    if (turnStr == "w") turn = WHITE;
-    else turn = BLACK;
+    const int sideToMove = packed.sideAndCastling & 1;
+    const int enPassantSquare = packed.enPassant != 0 ? packed.enPassant : -1;
+    if (packed.enPassant > 63) return fail("Invalid en passant square");
+
+    const char* invalid = checkPosition(pieces, sideToMove, enPassantSquare);
+    if (invalid != nullptr) return fail(invalid);
+
+    setPosition(pieces, sideToMove, (packed.sideAndCastling >> 1) & 15, enPassantSquare, packed.halfmoveClock, 1);
+    return true;
+}
+
+size_t Engine::writeFen(char* buffer) const
+{
+    char* out = buffer;
 
-    fenStream >> castlingStr;
-    castlingRights = { false, false, false, false };
-    for (const char& c : castlingStr)
+    for (int y = 7; y >= 0; --y)
     {
-        if (c == '-') break;
-        else if (c == 'Q') castlingRights[0] = true;
-        else if (c == 'K') castlingRights[1] = true;
-        else if (c == 'q') castlingRights[2] = true;
-        else if (c == 'k') castlingRights[3] = true;
+        int emptySquares = 0;
+        for (int x = 7; x >= 0; --x)
+        {
+            const int piece = board[x + y * 8];
+            if (piece == 0)
+            {
+                ++emptySquares;
+                continue;
+            }
+            if (emptySquares != 0) *out++ = (char)('0' + emptySquares);
+            emptySquares = 0;
+            *out++ = fenPieceChars[piece];
+        }
+        if (emptySquares != 0) *out++ = (char)('0' + emptySquares);
+        if (y != 0) *out++ = '/';
     }
 
-    fenStream >> enPassantStr;
-    if (enPassantStr != "-")
+    *out++ = ' ';
+    *out++ = turn == WHITE ? 'w' : 'b';
+
+    *out++ = ' ';
+    if (castlingRights == 0) *out++ = '-';
+    if (castlingRights & CASTLE_WK) *out++ = 'K';
+    if (castlingRights & CASTLE_WQ) *out++ = 'Q';
+    if (castlingRights & CASTLE_BK) *out++ = 'k';
+    if (castlingRights & CASTLE_BQ) *out++ = 'q';
+
+    *out++ = ' ';
+    if (enPassantTarget)
     {
-        enPassantTarget = getBitboardFromAlg(enPassantStr);
+        const int index = enPassantTarget.bitScanForward();
+        *out++ = (char)('a' + 7 - index % 8);
+        *out++ = (char)('1' + index / 8);
     }
+    else *out++ = '-';
+
+    *out++ = ' ';
+    out = std::to_chars(out, buffer + MAX_FEN_LENGTH, halfmoveClock).ptr;
+    *out++ = ' ';
+    out = std::to_chars(out, buffer + MAX_FEN_LENGTH, fullmoveNumber).ptr;
+
+    return out - buffer;
+}
+
+std::string Engine::toFen() const
+{
+    char buffer[MAX_FEN_LENGTH];
+    return std::string(buffer, writeFen(buffer));
 }
 
-Bitboard Engine::getOccupancyByColor(int color)
+Bitboard Engine::getOccupancyByColor(int color) const
 {
     int start = 0 + color * 6;
     int end = 6 + color * 6;
@@ -175,51 +697,267 @@ Bitboard Engine::getOccupancyByColor(int color)
     return result;
 }
 
-Bitboard Engine::getOccupiedSquares()
+Bitboard Engine::getOccupiedSquares() const
 {
     Bitboard result;
     for (const auto& i : piecePositions) result |= i;
     return result;
 }
 
-Bitboard Engine::getBitboardFromAlg(const std::string& a)
+std::string Engine::squareToString(int index)
 {
-    const char letter = a[0];
-    const char number = a[1];
+    std::string result;
+    result += (char)('a' + 7 - index % 8);
+    result += (char)('1' + index / 8);
+    return result;
+}
 
-    int x, y = number - 1;
+std::string Engine::moveToString(const Move& move)
+{
+    static const char promotionChars[7] = { 0, 'k', 'q', 'b', 'n', 'r', 'p' };
+
+    std::string result = squareToString(move.originIndex) + squareToString(move.targetIndex);
+    if (move.promotion != 0) result += promotionChars[move.promotion];
+    return result;
+}
 
-    switch (letter)
+bool Engine::parseMove(const std::string& str, Move& move)
+{
+    if (str.size() != 4 && str.size() != 5) return false;
+    if (str[0] < 'a' || str[0] > 'h' || str[2] < 'a' || str[2] > 'h') return false;
+    if (str[1] < '1' || str[1] > '8' || str[3] < '1' || str[3] > '8') return false;
+
+    const int origin = 7 - (str[0] - 'a') + (str[1] - '1') * 8;
+    const int target = 7 - (str[2] - 'a') + (str[3] - '1') * 8;
+    int promotion = 0;
+    if (str.size() == 5)
     {
-    case 'a':
-        x = 7;
-        break;
-    case 'b':
-        x = 6;
-        break;
-    case 'c':
-        x = 5;
-        break;
-    case 'd':
-        x = 4;
-        break;
-    case 'e':
-        x = 3;
-        break;
-    case 'f':
-        x = 2;
-        break;
-    case 'g':
-        x = 1;
-        break;
-    case 'h':
-        x = 0;
+        switch (str[4])
+        {
+        case 'q': promotion = QUEEN; break;
+        case 'b': promotion = BISHOP; break;
+        case 'n': promotion = KNIGHT; break;
+        case 'r': promotion = ROOK; break;
+        default: return false;
+        }
+    }
+
+    std::vector<Move> moves;
+    getLegalMoves(moves);
+    for (const Move& m : moves)
+    {
+        if (m == Move(origin, target, promotion))
+        {
+            move = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Engine::moveToSan(const Move& move)
+{
+    static const char pieceChars[7] = { 0, 'K', 'Q', 'B', 'N', 'R', 'P' };
+
+    const int color = move.originPiece > 6 ? BLACK : WHITE;
+    const int piece = move.originPiece - color * 6;
+    std::string result;
+
+    if (piece == KING && std::abs(move.targetIndex - move.originIndex) == 2)
+    {
+        result = move.targetIndex % 8 == 1 ? "O-O" : "O-O-O";
+    }
+    else
+    {
+        const std::string origin = squareToString(move.originIndex);
+        if (piece == PAWN)
+        {
+            if (isCapture(move)) result += origin[0];
+        }
+        else
+        {
+            result += pieceChars[piece];
+
+            // Name the origin file, else the rank, else both, if another piece of the kind can go to the same square
+            std::vector<Move> moves;
+            getLegalMoves(moves);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (const Move& other : moves)
+            {
+                if (other.originPiece != move.originPiece || other.targetIndex != move.targetIndex || other.originIndex == move.originIndex) continue;
+                ambiguous = true;
+                if (other.originIndex % 8 == move.originIndex % 8) sameFile = true;
+                if (other.originIndex / 8 == move.originIndex / 8) sameRank = true;
+            }
+            if (ambiguous && (!sameFile || sameRank)) result += origin[0];
+            if (ambiguous && sameFile) result += origin[1];
+        }
+
+        if (isCapture(move)) result += 'x';
+        result += squareToString(move.targetIndex);
+        if (move.promotion != 0)
+        {
+            result += '=';
+            result += pieceChars[move.promotion];
+        }
+    }
+
+    // Check or mate
+    makePseudoLegalMove(move);
+    if (isInCheck(turn))
+    {
+        std::vector<Move> replies;
+        getLegalMoves(replies);
+        result += replies.empty() ? '#' : '+';
+    }
+    undoMove(move);
+
+    return result;
+}
+
+bool Engine::parseSan(std::string_view san, Move& move)
+{
+    // Annotations and check marks are not needed to find the move
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) san.remove_suffix(1);
+    if (san.size() < 2) return false;
+
+    const int offset = turn * 6;
+
+    // Castling, also written with zeros
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0")
+    {
+        const bool kingSide = san.size() == 3;
+        const int right = kingSide ? (turn == WHITE ? CASTLE_WK : CASTLE_BK) : (turn == WHITE ? CASTLE_WQ : CASTLE_BQ);
+        if (!(castlingRights & right)) return false;
+
+        const int kingIndex = piecePositions[KING + offset - 1].bitScanForward();
+        move = Move(kingIndex, kingSide ? kingIndex - 2 : kingIndex + 2);
+        move.originPiece = KING + offset;
+        return true;
+    }
+
+    int piece = PAWN;
+    switch (san[0])
+    {
+    case 'K': piece = KING; break;
+    case 'Q': piece = QUEEN; break;
+    case 'B': piece = BISHOP; break;
+    case 'N': piece = KNIGHT; break;
+    case 'R': piece = ROOK; break;
+    }
+    if (piece != PAWN) san.remove_prefix(1);
+
+    // Promotion, with or without the '='
+    int promotion = 0;
+    if (san.size() >= 3)
+    {
+        switch (san.back())
+        {
+        case 'Q': promotion = QUEEN; break;
+        case 'B': promotion = BISHOP; break;
+        case 'N': promotion = KNIGHT; break;
+        case 'R': promotion = ROOK; break;
+        }
+        if (promotion != 0)
+        {
+            san.remove_suffix(1);
+            if (san.back() == '=') san.remove_suffix(1);
+        }
+    }
+
+    // The target square is last, anything before it other than an 'x' is the origin file and rank
+    if (san.size() < 2) return false;
+    const char targetFile = san[san.size() - 2];
+    const char targetRank = san[san.size() - 1];
+    if (targetFile < 'a' || targetFile > 'h' || targetRank < '1' || targetRank > '8') return false;
+    const int target = 7 - (targetFile - 'a') + (targetRank - '1') * 8;
+
+    int originFile = -1, originRank = -1;
+    bool capture = false;
+    for (size_t i = 0; i + 2 < san.size(); ++i)
+    {
+        const char c = san[i];
+        if (c >= 'a' && c <= 'h') originFile = 7 - (c - 'a');
+        else if (c >= '1' && c <= '8') originRank = c - '1';
+        else if (c == 'x') capture = true;
+        else if (c != '-') return false;
+    }
+
+    const int targetPiece = board[target];
+    if (targetPiece != 0 && (targetPiece > 6) == (turn == BLACK)) return false;
+
+    const bool lastRank = target / 8 == (turn == WHITE ? 7 : 0);
+    if ((promotion != 0) != (piece == PAWN && lastRank)) return false;
+
+    // Work back from the target square to the pieces of the kind that can reach it
+    const Bitboard occupied = getOccupiedSquares();
+    const Bitboard pieces = piecePositions[piece + offset - 1];
+    Bitboard origins;
+    switch (piece)
+    {
+    case KING: origins = kingAttackMasks[target] & pieces; break;
+    case KNIGHT: origins = knightAttackMasks[target] & pieces; break;
+    case BISHOP: origins = genSliderAttacks(target, occupied, pieces, Bitboard()); break;
+    case ROOK: origins = genSliderAttacks(target, occupied, Bitboard(), pieces); break;
+    case QUEEN: origins = genSliderAttacks(target, occupied, pieces, pieces); break;
+    case PAWN:
+        if (capture || originFile >= 0)
+        {
+            // A pawn capture onto an empty square is en passant
+            if (targetPiece == 0 && !(enPassantTarget == (Bitboard(1) << target))) return false;
+            origins = pawnAttackMasks[1 - turn][target] & pieces;
+        }
+        else
+        {
+            if (targetPiece != 0) return false;
+            const int behind = turn == WHITE ? target - VERTICAL : target + VERTICAL;
+            const int doubleRank = turn == WHITE ? 3 : 4;
+            if (board[behind] == (int)PAWN + offset) origins.setBit(behind, 1);
+            else if (board[behind] == 0 && target / 8 == doubleRank)
+            {
+                const int start = turn == WHITE ? behind - VERTICAL : behind + VERTICAL;
+                if (board[start] == (int)PAWN + offset) origins.setBit(start, 1);
+            }
+        }
         break;
     }
 
-    Bitboard res;
-    res.setBit(x + y * 8, 1);
-    return res;
+    // Anything the notation already rules out
+    Bitboard candidates;
+    while (origins)
+    {
+        const int origin = origins.bitScanForward();
+        origins = origins.resetLSB();
+        if (originFile >= 0 && origin % 8 != originFile) continue;
+        if (originRank >= 0 && origin / 8 != originRank) continue;
+        candidates.setBit(origin, 1);
+    }
+    if (!candidates) return false;
+
+    move = Move(candidates.bitScanForward(), target, promotion);
+    move.originPiece = piece + offset;
+    move.targetPiece = targetPiece;
+
+    // The notation is trusted when only one piece can make the move. Otherwise it names the one that is not pinned.
+    if (candidates.popCount() == 1) return true;
+
+    int legalCount = 0;
+    Move legalMove;
+    while (candidates)
+    {
+        move.originIndex = candidates.bitScanForward();
+        candidates = candidates.resetLSB();
+
+        makePseudoLegalMove(move);
+        const bool legal = !isInCheck(1 - turn);
+        undoMove(move);
+        if (!legal) continue;
+
+        legalMove = move;
+        ++legalCount;
+    }
+    move = legalMove;
+    return legalCount == 1;
 }
 
 void Engine::precomputePawnAttacks()
@@ -350,14 +1088,301 @@ void Engine::fillRayTable()
 void Engine::makePseudoLegalMove(Move move)
 {
     // Update board state
-    int originPiece = move.originPiece;
-    int targetPiece = move.targetPiece;
-    board[move.targetIndex] = originPiece;
-    board[move.originIndex] = 0;
+    hashHistory.push_back(hashKey);
+    undoHistory.push_back({ castlingRights, enPassantTarget, halfmoveClock });
+
+    const int color = move.originPiece > 6 ? BLACK : WHITE;
+    const int piece = move.originPiece - color * 6;
+
+    if (move.targetPiece != 0) removePiece(move.targetPiece, move.targetIndex);
+    else if (isCapture(move)) removePiece(PAWN + (1 - color) * 6, move.targetIndex + (color == WHITE ? -VERTICAL : VERTICAL));
+    removePiece(move.originPiece, move.originIndex);
+    addPiece(move.promotion ? move.promotion + color * 6 : move.originPiece, move.targetIndex);
+
+    // Castling is a king move of two squares, the rook jumps over it
+    if (piece == KING && std::abs(move.targetIndex - move.originIndex) == 2)
+    {
+        int rookOrigin, rookTarget;
+        getCastlingRookSquares(move.targetIndex, rookOrigin, rookTarget);
+        removePiece(ROOK + color * 6, rookOrigin);
+        addPiece(ROOK + color * 6, rookTarget);
+    }
+
+    // The square behind a double push is only kept if an enemy pawn can take on it,
+    // so positions that differ by an unusable en passant square still repeat
+    Bitboard newEnPassantTarget;
+    if (piece == PAWN && std::abs(move.targetIndex - move.originIndex) == 2 * VERTICAL)
+    {
+        const int square = (move.originIndex + move.targetIndex) / 2;
+        if (pawnAttackMasks[color][square] & piecePositions[PAWN + (1 - color) * 6 - 1]) newEnPassantTarget.setBit(square, 1);
+    }
+    setEnPassantTarget(newEnPassantTarget);
+    setCastlingRights(castlingRights & castlingMasks[move.originIndex] & castlingMasks[move.targetIndex]);
+    halfmoveClock = (piece == PAWN || move.targetPiece != 0) ? 0 : halfmoveClock + 1;
+    if (color == BLACK) ++fullmoveNumber;
 
-    if (targetPiece != 0) piecePositions[targetPiece - 1].setBit(move.targetIndex, 0);
-    piecePositions[originPiece - 1].setBit(move.originIndex, 0);
-    piecePositions[originPiece - 1].setBit(move.targetIndex, 1);
+    if (network) pushAccumulator(move);
+
+    hashKey ^= zobristTurnKey;
+    turn = 1 - turn;
+}
+
+void Engine::makeNullMove()
+{
+    // Pass the turn without moving. The en passant square belonged to the side that passed.
+    hashHistory.push_back(hashKey);
+    undoHistory.push_back({ castlingRights, enPassantTarget, halfmoveClock });
+    setEnPassantTarget(Bitboard());
+    ++halfmoveClock;
+    hashKey ^= zobristTurnKey;
+    turn = 1 - turn;
+}
+
+void Engine::undoNullMove()
+{
+    const UndoState& state = undoHistory.back();
+    enPassantTarget = state.enPassantTarget;
+    halfmoveClock = state.halfmoveClock;
+    undoHistory.pop_back();
+
+    turn = 1 - turn;
+    hashKey = hashHistory.back();
+    hashHistory.pop_back();
+}
+
+int Engine::getNonPawnPieceCount(int color) const
+{
+    const int offset = color * 6;
+    return (piecePositions[offset + QUEEN - 1] | piecePositions[offset + BISHOP - 1]
+        | piecePositions[offset + KNIGHT - 1] | piecePositions[offset + ROOK - 1]).popCount();
+}
+
+void Engine::getLegalMoves(std::vector<Move>& moves)
+{
+    genMovesForTurn(false, moves);
+    removeIllegalMoves(moves);
+}
+
+void Engine::getLegalCaptures(std::vector<Move>& moves)
+{
+    genMovesForTurn(true, moves);
+
+    // Pushes that promote to anything but a queen are quiet moves, so they are left to the full search
+    size_t kept = 0;
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        if (moves[i].promotion != 0 && moves[i].promotion != QUEEN && moves[i].targetPiece == 0) continue;
+        moves[kept++] = moves[i];
+    }
+    moves.resize(kept);
+
+    removeIllegalMoves(moves);
+}
+
+void Engine::genMovesForTurn(bool capturesOnly, std::vector<Move>& moves)
+{
+    moves.clear();
+
+    const int color = turn;
+    const int offset = color * 6;
+    const Bitboard& occupied = getOccupiedSquares();
+    const Bitboard& oppColorPieces = getOccupancyByColor(1 - color);
+
+    // For captures only, treat every square without an enemy piece as blocked and only allow pawn pushes that promote
+    const Bitboard& empty = capturesOnly ? ~occupied & (Bitboard::rank1 | Bitboard::rank8) : ~occupied;
+    const Bitboard& sameColorPieces = capturesOnly ? ~oppColorPieces : getOccupancyByColor(color);
+
+    getPawnMoves(piecePositions[offset + PAWN - 1], color, empty, oppColorPieces | enPassantTarget, moves);
+    getKnightMoves(piecePositions[offset + KNIGHT - 1], sameColorPieces, moves);
+    getBishopMoves(piecePositions[offset + BISHOP - 1], occupied, sameColorPieces, moves);
+    getRookMoves(piecePositions[offset + ROOK - 1], occupied, sameColorPieces, moves);
+    getQueenMoves(piecePositions[offset + QUEEN - 1], occupied, sameColorPieces, moves);
+    getKingMoves(piecePositions[offset + KING - 1], sameColorPieces, moves);
+    if (!capturesOnly) getCastlingMoves(color, occupied, moves);
+}
+
+void Engine::removeIllegalMoves(std::vector<Move>& moves)
+{
+    // Filter in place so the caller's buffer is reused between calls
+    const int color = turn;
+    size_t legalCount = 0;
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        makePseudoLegalMove(moves[i]);
+        const bool legal = !isInCheck(color);
+        undoMove(moves[i]);
+        if (legal) moves[legalCount++] = moves[i];
+    }
+    moves.resize(legalCount);
+}
+
+bool Engine::isSquareAttacked(int index, int byColor)
+{
+    return (getAttackersTo(index, getOccupiedSquares()) & getOccupancyByColor(byColor)) != 0;
+}
+
+Bitboard Engine::getAttackersTo(int index, const Bitboard& occupied) const
+{
+    const Bitboard queens = piecePositions[QUEEN - 1] | piecePositions[QUEEN + 5];
+    const Bitboard diagonalSliders = piecePositions[BISHOP - 1] | piecePositions[BISHOP + 5] | queens;
+    const Bitboard straightSliders = piecePositions[ROOK - 1] | piecePositions[ROOK + 5] | queens;
+
+    // A piece on the square attacks the same squares that attack it
+    Bitboard attackers;
+    attackers |= pawnAttackMasks[BLACK][index] & piecePositions[PAWN - 1];
+    attackers |= pawnAttackMasks[WHITE][index] & piecePositions[PAWN + 5];
+    attackers |= knightAttackMasks[index] & (piecePositions[KNIGHT - 1] | piecePositions[KNIGHT + 5]);
+    attackers |= kingAttackMasks[index] & (piecePositions[KING - 1] | piecePositions[KING + 5]);
+    attackers |= genSliderAttacks(index, occupied, diagonalSliders, straightSliders);
+    return attackers & occupied;
+}
+
+bool Engine::isThreatened(int color) const
+{
+    const int enemy = 1 - color;
+    Bitboard queens = piecePositions[enemy * 6 + QUEEN - 1];
+    if (!queens) return false;
+
+    // Most mates near the king start with the queen landing next to it where nothing but the king defends
+    const Bitboard occupied = getOccupiedSquares();
+    const Bitboard ownPieces = getOccupancyByColor(color);
+    const Bitboard king = piecePositions[color * 6 + KING - 1];
+    const Bitboard zone = kingAttackMasks[king.bitScanForward()] & ~ownPieces;
+    while (queens)
+    {
+        const int queen = queens.bitScanForward();
+        queens = queens.resetLSB();
+
+        Bitboard reached = (genBishopMoveMask(queen, occupied, Bitboard()) | genRookMoveMask(queen, occupied, Bitboard())) & zone;
+        while (reached)
+        {
+            const int index = reached.bitScanForward();
+            reached = reached.resetLSB();
+            if (!(getAttackersTo(index, occupied) & ownPieces & ~king)) return true;
+        }
+    }
+    return false;
+}
+
+Bitboard Engine::genSliderAttacks(int index, const Bitboard& occupied, const Bitboard& diagonalSliders, const Bitboard& straightSliders) const
+{
+    Bitboard attackers;
+    if (diagonalSliders) attackers |= genBishopMoveMask(index, occupied, Bitboard()) & diagonalSliders;
+    if (straightSliders) attackers |= genRookMoveMask(index, occupied, Bitboard()) & straightSliders;
+    return attackers;
+}
+
+int Engine::see(const Move& move) const
+{
+    // Swap list: gain[d] is the material balance if the exchange stops after capture d
+    int gain[32];
+    int d = 0;
+
+    const int target = move.targetIndex;
+    const int captured = move.targetPiece != 0 ? move.targetPiece : (isCapture(move) ? PAWN : 0);
+    const Bitboard queens = piecePositions[QUEEN - 1] | piecePositions[QUEEN + 5];
+    const Bitboard diagonalSliders = piecePositions[BISHOP - 1] | piecePositions[BISHOP + 5] | queens;
+    const Bitboard straightSliders = piecePositions[ROOK - 1] | piecePositions[ROOK + 5] | queens;
+    const Bitboard colorOccupancy[2] = { getOccupancyByColor(WHITE), getOccupancyByColor(BLACK) };
+
+    // An en passant victim is not on the target square, and taking it opens the file behind the target
+    Bitboard occupied = getOccupiedSquares();
+    if (captured != 0 && move.targetPiece == 0) occupied ^= Bitboard(1) << (move.targetIndex % 8 + move.originIndex / 8 * 8);
+    Bitboard attackers = getAttackersTo(target, occupied);
+    Bitboard attacker = Bitboard(1) << move.originIndex;
+    int color = move.originPiece > 6 ? BLACK : WHITE;
+
+    // A promoting pawn gains the difference, and it is the promoted piece that can be recaptured
+    int attackerPiece = move.promotion != 0 ? move.promotion : move.originPiece;
+    gain[0] = seeValues[captured > 6 ? captured - 6 : captured];
+    if (move.promotion != 0) gain[0] += seeValues[move.promotion] - seeValues[PAWN];
+    while (true)
+    {
+        ++d;
+        // Speculative: only counts if the other side turns out to have a recapture
+        gain[d] = seeValues[attackerPiece > 6 ? attackerPiece - 6 : attackerPiece] - gain[d - 1];
+        if (d == 31) break;
+
+        // Remove the attacker, which may uncover an x-ray attack through its square
+        occupied ^= attacker;
+        attackers |= genSliderAttacks(target, occupied, diagonalSliders & occupied, straightSliders & occupied);
+        attackers &= occupied;
+
+        color = 1 - color;
+        attacker = getLeastValuableAttacker(attackers & colorOccupancy[color], color, attackerPiece);
+        if (!attacker) break;
+    }
+
+    while (--d) gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    return gain[0];
+}
+
+bool Engine::seeGE(const Move& move, int threshold) const
+{
+    // Same exchange as see(), but stops as soon as the result is known to be above or below the threshold
+    const int captured = move.targetPiece != 0 ? move.targetPiece : (isCapture(move) ? PAWN : 0);
+    int swap = seeValues[captured > 6 ? captured - 6 : captured] - threshold;
+    if (move.promotion != 0) swap += seeValues[move.promotion] - seeValues[PAWN];
+    if (swap < 0) return false;
+
+    const int movedPiece = move.promotion != 0 ? move.promotion : (move.originPiece > 6 ? move.originPiece - 6 : move.originPiece);
+    swap = seeValues[movedPiece] - swap;
+    if (swap <= 0) return true;
+
+    const int target = move.targetIndex;
+    const Bitboard queens = piecePositions[QUEEN - 1] | piecePositions[QUEEN + 5];
+    const Bitboard diagonalSliders = piecePositions[BISHOP - 1] | piecePositions[BISHOP + 5] | queens;
+    const Bitboard straightSliders = piecePositions[ROOK - 1] | piecePositions[ROOK + 5] | queens;
+    const Bitboard colorOccupancy[2] = { getOccupancyByColor(WHITE), getOccupancyByColor(BLACK) };
+
+    Bitboard occupied = getOccupiedSquares() ^ (Bitboard(1) << move.originIndex) ^ (Bitboard(1) << target);
+    if (captured != 0 && move.targetPiece == 0) occupied ^= Bitboard(1) << (target % 8 + move.originIndex / 8 * 8);
+    Bitboard attackers = getAttackersTo(target, occupied);
+    int color = move.originPiece > 6 ? BLACK : WHITE;
+
+    // result is 1 while the side that made the capture is winning the exchange
+    int result = 1;
+    while (true)
+    {
+        color = 1 - color;
+        attackers &= occupied;
+
+        int attackerPiece;
+        const Bitboard attacker = getLeastValuableAttacker(attackers & colorOccupancy[color], color, attackerPiece);
+        if (!attacker) break;
+
+        result ^= 1;
+
+        // A king can only recapture if the other side has nothing left to take it with
+        const int piece = attackerPiece > 6 ? attackerPiece - 6 : attackerPiece;
+        if (piece == (int)KING) return (attackers & colorOccupancy[1 - color]) ? (result ^ 1) != 0 : result != 0;
+
+        swap = seeValues[piece] - swap;
+        if (swap < result) break;
+
+        // Removing the attacker may uncover an x-ray attack through its square
+        occupied ^= attacker;
+        attackers |= genSliderAttacks(target, occupied, diagonalSliders & occupied, straightSliders & occupied);
+    }
+
+    return result != 0;
+}
+
+Bitboard Engine::getLeastValuableAttacker(const Bitboard& attackers, int color, int& piece) const
+{
+    static const int order[6] = { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+
+    for (int type : order)
+    {
+        const Bitboard candidates = attackers & piecePositions[type + color * 6 - 1];
+        if (candidates)
+        {
+            piece = type + color * 6;
+            Bitboard lsb = candidates;
+            return lsb.isolateLSB();
+        }
+    }
+    return Bitboard();
 }
 
 std::vector<Move> Engine::getPieceMoves(int origin)
@@ -379,9 +1404,16 @@ std::vector<Move> Engine::getPieceMoves(int origin)
     std::vector<Move> moves;
     std::vector<Move> filtered;
 
-    if (piece == PAWN) getPawnMoves(pos, color, empty, oppColorPieces, moves);
+    // En passant and castling are only possible for the side to move
+    const Bitboard& enPassant = color == turn ? enPassantTarget : Bitboard();
+
+    if (piece == PAWN) getPawnMoves(pos, color, empty, oppColorPieces | enPassant, moves);
     else if (piece == KNIGHT) getKnightMoves(pos, sameColorPieces, moves);
-    else if (piece == KING) getKingMoves(pos, sameColorPieces, moves);
+    else if (piece == KING)
+    {
+        getKingMoves(pos, sameColorPieces, moves);
+        if (color == turn) getCastlingMoves(color, occupied, moves);
+    }
     else if (piece == BISHOP) getBishopMoves(pos, occupied, sameColorPieces, moves);
     else if (piece == ROOK) getRookMoves(pos, occupied, sameColorPieces, moves);
     else if (piece == QUEEN) getQueenMoves(pos, occupied, sameColorPieces, moves);
@@ -423,7 +1455,17 @@ void Engine::getPawnMoves(Bitboard pawnPositions, int color, const Bitboard& emp
             Move move(originIdx, targetIdx);
             move.originPiece = board[originIdx];
             move.targetPiece = board[targetIdx];
-            moves.push_back(move);
+            if (targetIdx < 8 || targetIdx >= 56)
+            {
+                // Queen first, so callers that take the first match promote to a queen
+                static const int promotions[4] = { QUEEN, KNIGHT, ROOK, BISHOP };
+                for (int promotion : promotions)
+                {
+                    move.promotion = promotion;
+                    moves.push_back(move);
+                }
+            }
+            else moves.push_back(move);
             targets = targets.resetLSB();   
         }
 
@@ -468,6 +1510,33 @@ void Engine::getKingMoves(Bitboard kingPosition, const Bitboard& sameColorPieces
     }
 }
 
+void Engine::getCastlingMoves(int color, const Bitboard& occupied, std::vector<Move>& moves)
+{
+    const int kingSide = color == WHITE ? CASTLE_WK : CASTLE_BK;
+    const int queenSide = color == WHITE ? CASTLE_WQ : CASTLE_BQ;
+    if (!(castlingRights & (kingSide | queenSide))) return;
+
+    // Rights are lost as soon as the king or rook moves, so both are still on their squares
+    const int backRank = color == WHITE ? 0 : 56;
+    const int kingIdx = backRank + 3;
+    const int oppColor = 1 - color;
+    if (isSquareAttacked(kingIdx, oppColor)) return;
+
+    // The king may not pass through check. Landing in check is left to the legality filter.
+    if ((castlingRights & kingSide) && !(occupied & (Bitboard(0x06) << backRank)) && !isSquareAttacked(kingIdx - 1, oppColor))
+    {
+        Move move(kingIdx, kingIdx - 2);
+        move.originPiece = board[kingIdx];
+        moves.push_back(move);
+    }
+    if ((castlingRights & queenSide) && !(occupied & (Bitboard(0x70) << backRank)) && !isSquareAttacked(kingIdx + 1, oppColor))
+    {
+        Move move(kingIdx, kingIdx + 2);
+        move.originPiece = board[kingIdx];
+        moves.push_back(move);
+    }
+}
+
 void Engine::getBishopMoves(Bitboard bishopPositions, const Bitboard& blockers, const Bitboard& sameColorPieces, std::vector<Move>& moves)
 {
 
@@ -613,7 +1682,7 @@ Bitboard Engine::genKingMoveMask(Bitboard kingPosition, const Bitboard& sameColo
     return targets;
 }
 
-Bitboard Engine::genBishopMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces)
+Bitboard Engine::genBishopMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces) const
 {
     Bitboard targets;
 
@@ -650,7 +1719,7 @@ Bitboard Engine::genBishopMoveMask(int originIdx, const Bitboard& blockers, cons
     return targets;
 }
 
-Bitboard Engine::genRookMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces)
+Bitboard Engine::genRookMoveMask(int originIdx, const Bitboard& blockers, const Bitboard& sameColorPieces) const
 {
     Bitboard targets;
 
@@ -726,14 +1795,10 @@ Bitboard Engine::genAttackMask(int color)
 
 bool Engine::isInCheck(int color)
 {
-    
-    // Generate attack mask of opposite color (should refactor into a function)
-    const int oppColor = color == WHITE ? BLACK : WHITE;
-    const Bitboard attacked = genAttackMask(oppColor);
+    // Look up the attackers of the king square rather than generating every attack of the other color
+    const int kingIdx = piecePositions[color == WHITE ? 0 : 6].bitScanForward();
+    if (kingIdx == -1) return false;
 
-    // Check if king is in attacked squares
-    const Bitboard& kingPos = piecePositions[color == WHITE ? 0 : 6];
-
-
-    return (kingPos & attacked) != 0;
+    const int oppColor = color == WHITE ? BLACK : WHITE;
+    return isSquareAttacked(kingIdx, oppColor);
 }
@@ -0,0 +1,140 @@
+#include "EngineWorker.h"
+
+EngineWorker::EngineWorker() : currentSearchId(0), nextSearchId(1), searching(false), quitting(false)
+{
+    search.setInfoCallback([this](const Search::Info& info) {
+        if (info.multiPv == 1) lastPv = info.pv;
+
+        Result result;
+        result.type = Result::INFO;
+        result.searchId = currentSearchId;
+        result.info = info;
+        postResult(result, false);
+    });
+
+    // Started last so everything it uses is already constructed
+    thread = std::thread(&EngineWorker::run, this);
+}
+
+EngineWorker::~EngineWorker()
+{
+    // The game loop has stopped polling, so a best move still to be posted is dropped rather than waited on
+    quitting.store(true);
+    stop();
+
+    Command command;
+    command.type = Command::QUIT;
+    pushCommand(command);
+    thread.join();
+}
+
+void EngineWorker::setPosition(const Engine& newPosition)
+{
+    Command command;
+    command.type = Command::SET_POSITION;
+    command.position = newPosition;
+    pushCommand(command);
+}
+
+int EngineWorker::go(const Search::Limits& limits)
+{
+    Command command;
+    command.type = Command::GO;
+    command.limits = limits;
+    command.searchId = nextSearchId++;
+    pushCommand(command);
+    return command.searchId;
+}
+
+void EngineWorker::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Searches that have not started yet are dropped, the running one is told to finish
+    for (auto it = commands.begin(); it != commands.end();)
+    {
+        if (it->type == Command::GO) it = commands.erase(it);
+        else ++it;
+    }
+    if (searching) search.stop();
+}
+
+void EngineWorker::ponderHit()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A ponder search that has not started yet simply becomes a normal one
+    for (Command& command : commands)
+    {
+        if (command.type == Command::GO) command.limits.ponder = false;
+    }
+    if (searching) search.ponderHit();
+}
+
+bool EngineWorker::pollResult(Result& result)
+{
+    return results.pop(result);
+}
+
+void EngineWorker::pushCommand(const Command& command)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(command);
+    }
+    commandAvailable.notify_one();
+}
+
+void EngineWorker::postResult(const Result& result, bool mustDeliver)
+{
+    while (!results.push(result))
+    {
+        if (!mustDeliver || quitting.load()) return;
+        std::this_thread::yield();
+    }
+}
+
+void EngineWorker::run()
+{
+    while (true)
+    {
+        Command command;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            commandAvailable.wait(lock, [this]() { return !commands.empty(); });
+            command = commands.front();
+            commands.pop_front();
+
+            // Set under the lock so a stop() from now on reaches this search, and one from before is not left behind for it
+            if (command.type == Command::GO)
+            {
+                searching = true;
+                search.prepare();
+            }
+        }
+
+        if (command.type == Command::QUIT) return;
+
+        if (command.type == Command::SET_POSITION)
+        {
+            position = command.position;
+            continue;
+        }
+
+        currentSearchId = command.searchId;
+        lastPv.clear();
+        const Search::Result searchResult = search.go(position, command.limits);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            searching = false;
+        }
+
+        Result result;
+        result.type = Result::BEST_MOVE;
+        result.searchId = command.searchId;
+        result.bestMove = searchResult.bestMove;
+        if (lastPv.size() > 1 && lastPv[0] == searchResult.bestMove) result.ponderMove = lastPv[1];
+        result.score = searchResult.score;
+        postResult(result, true);
+    }
+}
@@ -1,9 +1,10 @@
 #include <Game.h>
 
-Game::Game() : videoMode(1050, 600), window(videoMode, "ChessGUI", sf::Style::Titlebar | sf::Style::Close), board(600)
+Game::Game() : videoMode(1050, 600), window(videoMode, "ChessGUI", sf::Style::Titlebar | sf::Style::Close), board(600), engineThinking(false), engineSearchId(0), pondering(false), ponderResultReady(false)
 {
     window.setFramerateLimit(60);
     window.setKeyRepeatEnabled(false);
+    publishSnapshot();
 }
 
 void Game::start()
@@ -29,10 +30,99 @@ void Game::start()
 
 void Game::update()
 {
-    board.update(input, engine);
+    pollEngine();
+
+    // The player can only move on their own turn
+    if (engineThinking || engine.getTurn() != board.getPlayerColor()) return;
+
+    Move move;
+    const bool picked = board.update(input, snapshots.acquire(), move);
+    snapshots.release();
+
+    if (picked && engine.makeMove(move))
+    {
+        publishSnapshot();
+
+        if (pondering && move == ponderMove)
+        {
+            // Ponder hit: the search already running is the one we want
+            pondering = false;
+            engineThinking = true;
+            if (ponderResultReady) playEngineMove(ponderResult);
+            else engineWorker.ponderHit();
+        }
+        else
+        {
+            if (pondering) engineWorker.stop();
+            pondering = false;
+            startEngineSearch();
+        }
+    }
+}
+
+void Game::publishSnapshot()
+{
+    engine.writeSnapshot(snapshots.beginWrite());
+    snapshots.publish();
+}
+
+void Game::startEngineSearch()
+{
+    Search::Limits limits;
+    limits.moveTime = ENGINE_MOVE_TIME;
+
+    engineWorker.setPosition(engine);
+    engineSearchId = engineWorker.go(limits);
+    engineThinking = true;
+}
+
+void Game::startPondering(const Move& expectedMove)
+{
+    Engine position = engine;
+    Move move = expectedMove;
+    if (expectedMove.originPiece == 0 || !position.makeMove(move)) return;
+
+    Search::Limits limits;
+    limits.moveTime = ENGINE_MOVE_TIME;
+    limits.ponder = true;
+
+    engineWorker.setPosition(position);
+    engineSearchId = engineWorker.go(limits);
+    pondering = true;
+    ponderMove = move;
+    ponderResultReady = false;
+}
+
+void Game::playEngineMove(EngineWorker::Result& result)
+{
+    engineThinking = false;
+    if (engine.makeMove(result.bestMove))
+    {
+        publishSnapshot();
+        startPondering(result.ponderMove);
+    }
+}
+
+void Game::pollEngine()
+{
+    // Never blocks, so the window keeps drawing while the engine thinks
+    EngineWorker::Result result;
+    while (engineWorker.pollResult(result))
+    {
+        if (result.type != EngineWorker::Result::BEST_MOVE || result.searchId != engineSearchId) continue;
+
+        // A ponder search that ran out of depth keeps its move until the player makes theirs
+        if (pondering)
+        {
+            ponderResult = result;
+            ponderResultReady = true;
+        }
+        else playEngineMove(result);
+    }
 }
 
 void Game::render()
 {
-    board.render(window, engine);
+    board.render(window, snapshots.acquire());
+    snapshots.release();
 }
\ No newline at end of file
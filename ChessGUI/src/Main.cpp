@@ -1,10 +1,37 @@
 #include <Game.h>
 #include <Engine.h>
 #include <Bitboard.h>
+#include <Bench.h>
 #include <iostream>
+#include <string>
 
-int main()
+int main(int argc, char* argv[])
 {
+    // Benchmarks run from the command line without opening the window
+    if (argc > 1)
+    {
+        const std::string command = argv[1];
+
+        // Takes the network file before the depth
+        if (command == "bench-nnue")
+        {
+            if (argc > 2) Bench::nnue(std::cout, argv[2], argc > 3 ? std::stoi(argv[3]) : 6);
+            else std::cout << "Usage: bench-nnue <network> [depth]" << std::endl;
+            return 0;
+        }
+
+        const int depth = argc > 2 ? std::stoi(argv[2]) : 6;
+
+        if (command == "bench") Bench::search(std::cout, depth);
+        else if (command == "bench-pruning") Bench::pruning(std::cout, depth);
+        else if (command == "bench-aspiration") Bench::aspiration(std::cout, depth);
+        else if (command == "bench-smp") Bench::smpScaling(std::cout, depth);
+        else if (command == "bench-multipv") Bench::multiPv(std::cout, depth);
+        else if (command == "bench-fen") Bench::fen(std::cout, depth);
+        else std::cout << "Unknown command " << command << std::endl;
+        return 0;
+    }
+
     Game game;
     game.start();
-}
\ No newline at end of file
+}
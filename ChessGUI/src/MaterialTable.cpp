@@ -0,0 +1,120 @@
+#include "MaterialTable.h"
+#include "Engine.h"
+#include "PieceSquareTable.h"
+#include <algorithm>
+
+MaterialTable::MaterialTable(size_t size)
+{
+    // Round down to a power of two so the key can be masked
+    size_t count = 1;
+    while (count * 2 <= size) count *= 2;
+    entries.resize(count);
+    mask = count - 1;
+}
+
+void MaterialTable::clear()
+{
+    std::fill(entries.begin(), entries.end(), Entry());
+}
+
+const MaterialTable::Entry& MaterialTable::probe(uint64_t materialKey, const std::vector<Bitboard>& pieces)
+{
+    Entry& entry = entries[materialKey & mask];
+    if (entry.key == materialKey) return entry;
+
+    evaluate(pieces, entry);
+    entry.key = materialKey;
+    return entry;
+}
+
+void MaterialTable::evaluate(const std::vector<Bitboard>& pieces, Entry& entry)
+{
+    int counts[12];
+    for (int i = 0; i != 12; ++i) counts[i] = pieces[i].popCount();
+
+    entry = Entry();
+    for (int i = 0; i != 12; ++i)
+    {
+        entry.phase += counts[i] * PieceSquareTable::phaseWeights[i % 6 + 1];
+    }
+    entry.phase = std::min(entry.phase, (int)PieceSquareTable::MAX_PHASE);
+
+    for (int color = Engine::WHITE; color <= (int)Engine::BLACK; ++color)
+    {
+        const int offset = color * 6;
+        const int sign = color == Engine::WHITE ? 1 : -1;
+        const int pawnsAboveFive = counts[Engine::PAWN - 1 + offset] - 5;
+
+        int mg = 0;
+        int eg = 0;
+        if (counts[Engine::BISHOP - 1 + offset] >= 2)
+        {
+            mg += BISHOP_PAIR_MG;
+            eg += BISHOP_PAIR_EG;
+        }
+        const int pawnAdjustment = pawnsAboveFive * (counts[Engine::KNIGHT - 1 + offset] * KNIGHT_PAWN_ADJUSTMENT + counts[Engine::ROOK - 1 + offset] * ROOK_PAWN_ADJUSTMENT);
+        mg += pawnAdjustment;
+        eg += pawnAdjustment;
+
+        entry.imbalanceMg += sign * mg;
+        entry.imbalanceEg += sign * eg;
+
+        findEndgame(counts, color, entry);
+    }
+}
+
+void MaterialTable::findEndgame(const int counts[12], int color, Entry& entry)
+{
+    const int own = color * 6;
+    const int opp = 6 - own;
+    const int queens = counts[Engine::QUEEN - 1 + own];
+    const int rooks = counts[Engine::ROOK - 1 + own];
+    const int bishops = counts[Engine::BISHOP - 1 + own];
+    const int knights = counts[Engine::KNIGHT - 1 + own];
+    const int pawns = counts[Engine::PAWN - 1 + own];
+    const int minors = bishops + knights;
+
+    bool oppBareKing = true;
+    for (int piece = Engine::QUEEN; piece <= (int)Engine::PAWN; ++piece)
+    {
+        if (counts[piece - 1 + opp] != 0) oppBareKing = false;
+    }
+
+    // Known wins against a bare king
+    if (oppBareKing)
+    {
+        // evaluateKXK checks that the bishops cover both colours
+        if (queens + rooks > 0 || bishops >= 2)
+        {
+            entry.evaluate = Endgame::evaluateKXK;
+            entry.strongSide = color;
+            return;
+        }
+        if (bishops == 1 && knights == 1 && pawns == 0)
+        {
+            entry.evaluate = Endgame::evaluateKBNK;
+            entry.strongSide = color;
+            return;
+        }
+        if (pawns == 1 && minors == 0)
+        {
+            entry.evaluate = Endgame::evaluateKPK;
+            entry.strongSide = color;
+            return;
+        }
+    }
+
+    // Without pawns a single minor piece cannot mate
+    if (pawns == 0 && queens + rooks == 0 && minors <= 1)
+    {
+        entry.scale[color] = Endgame::scaleInsufficientMaterial;
+        return;
+    }
+
+    // One bishop each and nothing else but pawns; the function checks the square colours
+    const int oppMinorsAndMajors = counts[Engine::QUEEN - 1 + opp] + counts[Engine::ROOK - 1 + opp] + counts[Engine::KNIGHT - 1 + opp];
+    if (bishops == 1 && knights + rooks + queens == 0 && counts[Engine::BISHOP - 1 + opp] == 1 && oppMinorsAndMajors == 0)
+    {
+        entry.scale[color] = Endgame::scaleOppositeBishops;
+    }
+}
@@ -0,0 +1,258 @@
+#include "Nnue.h"
+#include "Engine.h"
+#include <cstring>
+
+// The projects build with /arch:AVX2, which defines __AVX2__. MSVC never defines __SSE4_1__, so that path is for
+// other compilers built with -msse4.1, and anything else falls back to plain loops.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+// Sections start on 64 byte boundaries so they can be read with aligned loads by other tools
+static size_t alignSection(size_t offset)
+{
+    return (offset + 63) & ~(size_t)63;
+}
+
+Nnue::Nnue() : ftBiases(nullptr), ftWeights(nullptr), hidden1Biases(nullptr), hidden1Weights(nullptr),
+    hidden2Biases(nullptr), hidden2Weights(nullptr), outputBias(nullptr), outputWeights(nullptr)
+{
+}
+
+bool Nnue::load(const std::string& path)
+{
+    if (!file.open(path)) return false;
+
+    size_t offset = 64;
+    const size_t ftBiasesOffset = offset;
+    offset = alignSection(offset + sizeof(int16_t) * L1);
+    const size_t ftWeightsOffset = offset;
+    offset = alignSection(offset + sizeof(int16_t) * (size_t)INPUTS * L1);
+    const size_t hidden1BiasesOffset = offset;
+    offset = alignSection(offset + sizeof(int32_t) * L2);
+    const size_t hidden1WeightsOffset = offset;
+    offset = alignSection(offset + sizeof(int8_t) * L2 * 2 * L1);
+    const size_t hidden2BiasesOffset = offset;
+    offset = alignSection(offset + sizeof(int32_t) * L3);
+    const size_t hidden2WeightsOffset = offset;
+    offset = alignSection(offset + sizeof(int8_t) * L3 * L2);
+    const size_t outputBiasOffset = offset;
+    offset = alignSection(offset + sizeof(int32_t));
+    const size_t outputWeightsOffset = offset;
+    offset += sizeof(int8_t) * L3;
+
+    // A file of the expected size always has room for the header
+    const unsigned char* data = file.getData();
+    uint32_t version = 0;
+    if (file.getSize() == offset) std::memcpy(&version, data + 4, sizeof(version));
+
+    if (file.getSize() != offset || std::memcmp(data, "CBNN", 4) != 0 || version != VERSION)
+    {
+        file.close();
+        return false;
+    }
+
+    ftBiases = reinterpret_cast<const int16_t*>(data + ftBiasesOffset);
+    ftWeights = reinterpret_cast<const int16_t*>(data + ftWeightsOffset);
+    hidden1Biases = reinterpret_cast<const int32_t*>(data + hidden1BiasesOffset);
+    hidden1Weights = reinterpret_cast<const int8_t*>(data + hidden1WeightsOffset);
+    hidden2Biases = reinterpret_cast<const int32_t*>(data + hidden2BiasesOffset);
+    hidden2Weights = reinterpret_cast<const int8_t*>(data + hidden2WeightsOffset);
+    outputBias = reinterpret_cast<const int32_t*>(data + outputBiasOffset);
+    outputWeights = reinterpret_cast<const int8_t*>(data + outputWeightsOffset);
+    return true;
+}
+
+bool Nnue::isLoaded() const
+{
+    return file.isOpen();
+}
+
+int Nnue::getFeatureIndex(int perspective, int kingSquare, int piece, int square)
+{
+    // Pieces are numbered relative to the perspective: own queen, enemy queen, own bishop, ...
+    // and black sees the board flipped so both sides share the same weights
+    const int color = piece > 6 ? Engine::BLACK : Engine::WHITE;
+    const int type = piece > 6 ? piece - 6 : piece;
+    const int kind = (type - Engine::QUEEN) * 2 + (color != perspective ? 1 : 0);
+    if (perspective == Engine::BLACK)
+    {
+        kingSquare ^= 56;
+        square ^= 56;
+    }
+    return kingSquare * 640 + kind * 64 + square;
+}
+
+void Nnue::refresh(Accumulator& accumulator, int perspective, const std::vector<Bitboard>& pieces) const
+{
+    int16_t* values = accumulator.values[perspective];
+    std::memcpy(values, ftBiases, sizeof(int16_t) * L1);
+
+    const int kingSquare = pieces[perspective == Engine::WHITE ? Engine::KING - 1 : Engine::KING + 5].bitScanForward();
+    for (int piece = 1; piece <= 12; ++piece)
+    {
+        if (piece == Engine::KING || piece == Engine::KING + 6) continue;
+
+        Bitboard positions = pieces[piece - 1];
+        while (positions)
+        {
+            const int square = positions.bitScanForward();
+            addFeature(values, ftWeights + (size_t)getFeatureIndex(perspective, kingSquare, piece, square) * L1);
+            positions = positions.resetLSB();
+        }
+    }
+}
+
+void Nnue::update(Accumulator& accumulator, int perspective, int kingSquare, int piece, int from, int to, int removedPiece, int removedSquare) const
+{
+    int16_t* values = accumulator.values[perspective];
+    if (from != -1) subFeature(values, ftWeights + (size_t)getFeatureIndex(perspective, kingSquare, piece, from) * L1);
+    if (to != -1) addFeature(values, ftWeights + (size_t)getFeatureIndex(perspective, kingSquare, piece, to) * L1);
+    if (removedSquare != -1) subFeature(values, ftWeights + (size_t)getFeatureIndex(perspective, kingSquare, removedPiece, removedSquare) * L1);
+}
+
+int Nnue::evaluate(const Accumulator& accumulator, int sideToMove) const
+{
+    // The side to move's half always comes first
+    uint8_t input[2 * L1];
+    clipAccumulator(accumulator.values[sideToMove], input);
+    clipAccumulator(accumulator.values[1 - sideToMove], input + L1);
+
+    int32_t hidden1[L2];
+    uint8_t hidden1Output[L2];
+    affine(input, 2 * L1, hidden1Weights, hidden1Biases, hidden1, L2);
+    clipHidden(hidden1, hidden1Output, L2);
+
+    int32_t hidden2[L3];
+    uint8_t hidden2Output[L3];
+    affine(hidden1Output, L2, hidden2Weights, hidden2Biases, hidden2, L3);
+    clipHidden(hidden2, hidden2Output, L3);
+
+    return (*outputBias + dot(hidden2Output, outputWeights, L3)) / OUTPUT_SCALE;
+}
+
+void Nnue::addFeature(int16_t* values, const int16_t* weights)
+{
+#if defined(__AVX2__)
+    for (int i = 0; i != L1; i += 16)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), _mm256_add_epi16(v, w));
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i != L1; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_add_epi16(v, w));
+    }
+#else
+    for (int i = 0; i != L1; ++i) values[i] += weights[i];
+#endif
+}
+
+void Nnue::subFeature(int16_t* values, const int16_t* weights)
+{
+#if defined(__AVX2__)
+    for (int i = 0; i != L1; i += 16)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), _mm256_sub_epi16(v, w));
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i != L1; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_sub_epi16(v, w));
+    }
+#else
+    for (int i = 0; i != L1; ++i) values[i] -= weights[i];
+#endif
+}
+
+void Nnue::clipAccumulator(const int16_t* input, uint8_t* output)
+{
+#if defined(__AVX2__)
+    const __m256i max = _mm256_set1_epi16(127);
+    for (int i = 0; i != L1; i += 32)
+    {
+        const __m256i a = _mm256_min_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i)), max);
+        const __m256i b = _mm256_min_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i + 16)), max);
+        // Packing works within 128 bit lanes, so the 64 bit quarters are put back in order afterwards
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+    }
+#elif defined(__SSE4_1__)
+    const __m128i max = _mm_set1_epi16(127);
+    for (int i = 0; i != L1; i += 16)
+    {
+        const __m128i a = _mm_min_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)), max);
+        const __m128i b = _mm_min_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8)), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(a, b));
+    }
+#else
+    for (int i = 0; i != L1; ++i)
+    {
+        const int value = input[i];
+        output[i] = (uint8_t)(value < 0 ? 0 : (value > 127 ? 127 : value));
+    }
+#endif
+}
+
+void Nnue::clipHidden(const int32_t* input, uint8_t* output, int size)
+{
+    // Only 32 values per layer, so this is left to the compiler
+    for (int i = 0; i != size; ++i)
+    {
+        const int value = input[i] >> WEIGHT_SHIFT;
+        output[i] = (uint8_t)(value < 0 ? 0 : (value > 127 ? 127 : value));
+    }
+}
+
+void Nnue::affine(const uint8_t* input, int inputSize, const int8_t* weights, const int32_t* biases, int32_t* output, int outputSize)
+{
+    for (int i = 0; i != outputSize; ++i)
+    {
+        output[i] = biases[i] + dot(input, weights + (size_t)i * inputSize, inputSize);
+    }
+}
+
+int32_t Nnue::dot(const uint8_t* input, const int8_t* weights, int size)
+{
+#if defined(__AVX2__)
+    // maddubs multiplies unsigned by signed bytes into pairs of int16; inputs are at most 127 so this cannot saturate
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i != size; i += 32)
+    {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+    return _mm_cvtsi128_si32(total);
+#elif defined(__SSE4_1__)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i != size; i += 16)
+    {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i != size; ++i) sum += input[i] * weights[i];
+    return sum;
+#endif
+}
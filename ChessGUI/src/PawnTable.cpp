@@ -0,0 +1,120 @@
+#include "PawnTable.h"
+#include "Engine.h"
+#include <algorithm>
+
+const int PawnTable::passedMg[8] = { 0, 5, 10, 15, 30, 50, 80, 0 };
+const int PawnTable::passedEg[8] = { 0, 10, 20, 35, 60, 100, 150, 0 };
+
+// Shifts towards the a file and towards the h file, dropping pawns that would wrap around the board
+static Bitboard shiftWest(const Bitboard& bb) { return (bb & ~Bitboard::aFile) << 1; }
+static Bitboard shiftEast(const Bitboard& bb) { return (bb & ~Bitboard::hFile) >> 1; }
+
+PawnTable::PawnTable(size_t size) : probes(0), hits(0)
+{
+    // Round down to a power of two so the key can be masked
+    size_t count = 1;
+    while (count * 2 <= size) count *= 2;
+    entries.resize(count);
+    mask = count - 1;
+}
+
+void PawnTable::clear()
+{
+    std::fill(entries.begin(), entries.end(), Entry());
+}
+
+uint64_t PawnTable::getProbes() const
+{
+    return probes;
+}
+
+uint64_t PawnTable::getHits() const
+{
+    return hits;
+}
+
+void PawnTable::resetStats()
+{
+    probes = 0;
+    hits = 0;
+}
+
+const PawnTable::Entry& PawnTable::probe(uint64_t pawnKey, const Bitboard& whitePawns, const Bitboard& blackPawns)
+{
+    ++probes;
+    Entry& entry = entries[pawnKey & mask];
+    if (entry.key == pawnKey)
+    {
+        ++hits;
+        return entry;
+    }
+
+    evaluate(whitePawns, blackPawns, entry);
+    entry.key = pawnKey;
+    return entry;
+}
+
+void PawnTable::evaluate(const Bitboard& whitePawns, const Bitboard& blackPawns, Entry& entry)
+{
+    // Squares in front of each side's pawns, and the squares those pawns could ever attack while advancing
+    const Bitboard whiteFront = (whitePawns << 8).northFill();
+    const Bitboard blackFront = (blackPawns >> 8).southFill();
+    const Bitboard whiteAttackSpan = shiftWest(whitePawns.northFill()) | shiftEast(whitePawns.northFill());
+    const Bitboard blackAttackSpan = shiftWest(blackPawns.southFill()) | shiftEast(blackPawns.southFill());
+    const Bitboard whiteAttacks = shiftWest(whitePawns << 8) | shiftEast(whitePawns << 8);
+    const Bitboard blackAttacks = shiftWest(blackPawns >> 8) | shiftEast(blackPawns >> 8);
+
+    // Passed: no enemy pawn ahead on the same or an adjacent file. Only the front pawn of a doubled pair counts.
+    const Bitboard whitePassed = whitePawns & ~(blackFront | shiftWest(blackFront) | shiftEast(blackFront)) & ~(whitePawns >> 8).southFill();
+    const Bitboard blackPassed = blackPawns & ~(whiteFront | shiftWest(whiteFront) | shiftEast(whiteFront)) & ~(blackPawns << 8).northFill();
+
+    // Isolated: no friendly pawn on an adjacent file
+    const Bitboard whiteFiles = whitePawns.fileFill();
+    const Bitboard blackFiles = blackPawns.fileFill();
+    const Bitboard whiteIsolated = whitePawns & ~(shiftWest(whiteFiles) | shiftEast(whiteFiles));
+    const Bitboard blackIsolated = blackPawns & ~(shiftWest(blackFiles) | shiftEast(blackFiles));
+
+    // Doubled: another friendly pawn further ahead on the same file
+    const Bitboard whiteDoubled = whitePawns & (whitePawns >> 8).southFill();
+    const Bitboard blackDoubled = blackPawns & (blackPawns << 8).northFill();
+
+    // Backward: the stop square is attacked by an enemy pawn and no friendly pawn can ever defend it
+    const Bitboard whiteBackward = ((whitePawns << 8) & blackAttacks & ~whiteAttackSpan) >> 8;
+    const Bitboard blackBackward = ((blackPawns >> 8) & whiteAttacks & ~blackAttackSpan) << 8;
+
+    int mg = 0;
+    int eg = 0;
+    scorePassedPawns(whitePassed, Engine::WHITE, mg, eg);
+    scorePassedPawns(blackPassed, Engine::BLACK, mg, eg);
+
+    const int isolated = whiteIsolated.popCount() - blackIsolated.popCount();
+    const int doubled = whiteDoubled.popCount() - blackDoubled.popCount();
+    const int backward = whiteBackward.popCount() - blackBackward.popCount();
+    mg += isolated * ISOLATED_MG + doubled * DOUBLED_MG + backward * BACKWARD_MG;
+    eg += isolated * ISOLATED_EG + doubled * DOUBLED_EG + backward * BACKWARD_EG;
+
+    entry.mgScore = mg;
+    entry.egScore = eg;
+}
+
+void PawnTable::scorePassedPawns(Bitboard passed, int color, int& mg, int& eg)
+{
+    const int sign = (color == Engine::WHITE) ? 1 : -1;
+    while (passed)
+    {
+        const int rank = passed.bitScanForward() / 8;
+        const int relativeRank = (color == Engine::WHITE) ? rank : 7 - rank;
+        mg += sign * passedMg[relativeRank];
+        eg += sign * passedEg[relativeRank];
+        passed = passed.resetLSB();
+    }
+}
+
+int PawnTable::evaluateShield(const Bitboard& kingPosition, const Bitboard& pawns, int color)
+{
+    // The king's file and the two next to it, one and two ranks ahead
+    const Bitboard zone = kingPosition | shiftWest(kingPosition) | shiftEast(kingPosition);
+    const Bitboard near = (color == Engine::WHITE) ? zone << 8 : zone >> 8;
+    const Bitboard far = (color == Engine::WHITE) ? zone << 16 : zone >> 16;
+    return (pawns & near).popCount() * SHIELD_NEAR + (pawns & far).popCount() * SHIELD_FAR;
+}
@@ -0,0 +1,184 @@
+#include "Search.h"
+#include "SearchThread.h"
+#include <thread>
+
+Search::Search() : tt(16), stopped(false), ponderHitReceived(false), stopOnPonderHit(false), probeTablebases(false)
+{
+    setThreads(1);
+}
+
+Search::~Search()
+{
+}
+
+void Search::setThreads(int count)
+{
+    if (count < 1) count = 1;
+
+    threads.clear();
+    for (int id = 0; id != count; ++id)
+    {
+        threads.push_back(std::unique_ptr<SearchThread>(new SearchThread(*this, id)));
+    }
+}
+
+int Search::getThreads() const
+{
+    return (int)threads.size();
+}
+
+void Search::setHashSize(size_t megabytes)
+{
+    tt.resize(megabytes);
+}
+
+void Search::clearHash()
+{
+    tt.clear();
+}
+
+void Search::setInfoCallback(std::function<void(const Info&)> callback)
+{
+    infoCallback = callback;
+}
+
+void Search::setOptions(const Options& newOptions)
+{
+    options = newOptions;
+}
+
+const Search::Options& Search::getOptions() const
+{
+    return options;
+}
+
+void Search::setTablebases(std::shared_ptr<Tablebases> newTablebases)
+{
+    tablebases = newTablebases;
+}
+
+void Search::stop()
+{
+    stopped.store(true, std::memory_order_relaxed);
+}
+
+void Search::ponderHit()
+{
+    // Sequentially consistent, so either this sees stopOnPonderHit or the main thread sees the hit
+    ponderHitReceived.store(true);
+    if (stopOnPonderHit.load()) stop();
+}
+
+bool Search::isPondering() const
+{
+    return limits.ponder && !ponderHitReceived.load();
+}
+
+void Search::prepare()
+{
+    stopped.store(false, std::memory_order_relaxed);
+    ponderHitReceived.store(false, std::memory_order_relaxed);
+    stopOnPonderHit.store(false, std::memory_order_relaxed);
+}
+
+Search::Result Search::go(const Engine& position, const Limits& searchLimits)
+{
+    limits = searchLimits;
+    if (limits.depth > MAX_PLY - 1) limits.depth = MAX_PLY - 1;
+    startTime = std::chrono::steady_clock::now();
+    tt.newSearch();
+
+    if (limits.time > 0 || limits.moveTime > 0) timeManager.start(limits.time, limits.increment, limits.movesToGo, limits.moveTime);
+    else timeManager.disable();
+
+    tablebaseRootMoves.clear();
+    probeTablebases = tablebases && tablebases->getMaxPieces() > 0;
+    if (probeTablebases)
+    {
+        Engine root = position;
+        std::vector<Move> moves;
+        root.getLegalMoves(moves);
+        bool usedDtz;
+        if (tablebases->filterRootMoves(root, moves, usedDtz))
+        {
+            tablebaseRootMoves = moves;
+            probeTablebases = !usedDtz;
+        }
+    }
+
+    for (auto& thread : threads) thread->setPosition(position);
+
+    // Helpers run on their own threads, the main thread runs here
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < threads.size(); ++i)
+    {
+        SearchThread* thread = threads[i].get();
+        helpers.push_back(std::thread([thread]() { thread->iterativeDeepening(); }));
+    }
+
+    threads[0]->iterativeDeepening();
+
+    // Stays set until the next prepare(), so a late stop() has nothing to leave behind
+    stopped.store(true, std::memory_order_relaxed);
+    for (std::thread& helper : helpers) helper.join();
+
+    // Take the deepest completed iteration, preferring the main thread on ties.
+    // Only the main thread searches every MultiPV line.
+    SearchThread* best = threads[0].get();
+    for (auto& thread : threads)
+    {
+        if (limits.multiPv <= 1 && thread->completedDepth > best->completedDepth) best = thread.get();
+    }
+
+    Result result;
+    result.bestMove = best->bestMove;
+    result.score = best->bestScore;
+    result.depth = best->completedDepth;
+    result.nodes = getNodes();
+    result.lines = best->lines;
+    for (auto& thread : threads) result.stats += thread->stats;
+    return result;
+}
+
+uint64_t Search::getNodes() const
+{
+    uint64_t total = 0;
+    for (const auto& thread : threads) total += thread->getNodes();
+    return total;
+}
+
+int64_t Search::getElapsedMs() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Search::checkLimits()
+{
+    if (limits.nodes != 0 && getNodes() >= limits.nodes) stop();
+    if (!isPondering() && timeManager.isHardLimitReached(getElapsedMs())) stop();
+}
+
+double Search::Stats::firstMoveCutoffRate() const
+{
+    return cutoffs > 0 ? 100.0 * firstMoveCutoffs / cutoffs : 0.0;
+}
+
+double Search::Stats::pawnHitRate() const
+{
+    return pawnProbes > 0 ? 100.0 * pawnHits / pawnProbes : 0.0;
+}
+
+Search::Stats& Search::Stats::operator+=(const Stats& rhs)
+{
+    cutoffs += rhs.cutoffs;
+    firstMoveCutoffs += rhs.firstMoveCutoffs;
+    qnodes += rhs.qnodes;
+    pvsResearches += rhs.pvsResearches;
+    lmrResearches += rhs.lmrResearches;
+    aspirationFailLows += rhs.aspirationFailLows;
+    aspirationFailHighs += rhs.aspirationFailHighs;
+    pawnProbes += rhs.pawnProbes;
+    pawnHits += rhs.pawnHits;
+    tbHits += rhs.tbHits;
+    return *this;
+}
@@ -0,0 +1,631 @@
+#include "SearchThread.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+// Depth skipping pattern for helper threads, indexed by (id - 1) % 20
+static const int skipSize[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static const int skipPhase[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// How often the main thread checks the search limits
+static const uint64_t checkInterval = 1024;
+
+int SearchThread::lmrTable[64][64];
+
+void SearchThread::initLmrTable()
+{
+    for (int depth = 1; depth != 64; ++depth)
+    for (int moveNumber = 1; moveNumber != 64; ++moveNumber)
+    {
+        lmrTable[depth][moveNumber] = (int)(0.75 + std::log((double)depth) * std::log((double)moveNumber) / 2.25);
+    }
+}
+
+SearchThread::SearchThread(Search& search, int id) : bestScore(0), completedDepth(0), search(search), id(id), nodes(0), bestMoveNodes(0), randomState(0x2545F4914F6CDD1D * (id + 1)), nullMoveMinPly(0)
+{
+    static const bool lmrTableReady = (initLmrTable(), true);
+    (void)lmrTableReady;
+
+    for (StackEntry& entry : stack)
+    {
+        entry.moves.reserve(128);
+        entry.moveScores.reserve(128);
+        entry.quietsTried.reserve(128);
+    }
+
+    std::memset(killers, 0, sizeof(killers));
+    std::memset(history, 0, sizeof(history));
+    std::memset(counterMoves, 0, sizeof(counterMoves));
+}
+
+void SearchThread::setPosition(const Engine& newPosition)
+{
+    position = newPosition;
+}
+
+uint64_t SearchThread::getNodes() const
+{
+    return nodes.load(std::memory_order_relaxed);
+}
+
+bool SearchThread::isStopped() const
+{
+    return search.stopped.load(std::memory_order_relaxed);
+}
+
+void SearchThread::countNode()
+{
+    // Only this thread writes its counter, so a plain load and store is enough
+    const uint64_t count = nodes.load(std::memory_order_relaxed) + 1;
+    nodes.store(count, std::memory_order_relaxed);
+
+    if (id == 0 && count % checkInterval == 0) search.checkLimits();
+}
+
+uint64_t SearchThread::nextRandom()
+{
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1D;
+}
+
+bool SearchThread::skipDepth(int depth) const
+{
+    if (id == 0) return false;
+    const int i = (id - 1) % 20;
+    return ((depth + skipPhase[i]) / skipSize[i]) % 2 != 0;
+}
+
+void SearchThread::iterativeDeepening()
+{
+    nodes.store(0, std::memory_order_relaxed);
+    bestMove = Move();
+    bestScore = 0;
+    completedDepth = 0;
+    pv.clear();
+    lines.clear();
+    stats = Search::Stats();
+    pawnTable.resetStats();
+    nullMoveMinPly = 0;
+    resetOrderingTables();
+
+    // Helpers only look for the best move, the main thread finds every MultiPV line
+    position.getLegalMoves(stack[0].moves);
+    if (stack[0].moves.empty()) return; // Nothing to search at the root
+    const int rootMoveCount = (int)(search.tablebaseRootMoves.empty() ? stack[0].moves.size() : search.tablebaseRootMoves.size());
+    const int lineCount = id == 0 ? std::max(1, std::min(search.limits.multiPv, rootMoveCount)) : 1;
+
+    for (int depth = 1; depth <= search.limits.depth; ++depth)
+    {
+        if (depth > 1 && skipDepth(depth)) continue;
+
+        const uint64_t iterationStartNodes = getNodes();
+        excludedRootMoves.clear();
+        iterationLines.clear();
+
+        // Each line searches the root without the moves of the lines above it
+        for (int lineIndex = 0; lineIndex != lineCount; ++lineIndex)
+        {
+            // Aspiration window: search a narrow window around the last score, widening it on failure.
+            // A later line cannot score above the one before it, so its window stops just above that.
+            int alpha = -Search::INFINITE_SCORE;
+            int beta = Search::INFINITE_SCORE;
+            int delta = search.options.aspirationWindow;
+            const int ceiling = lineIndex > 0 ? iterationLines.back().score : Search::INFINITE_SCORE;
+            if (depth >= 4 && delta > 0 && lineIndex < (int)lines.size() && std::abs(lines[lineIndex].score) < Search::MATE_SCORE - Search::MAX_PLY)
+            {
+                const int center = std::min(lines[lineIndex].score, ceiling);
+                alpha = std::max(center - delta, -Search::INFINITE_SCORE);
+                beta = std::min(center + delta, (int)Search::INFINITE_SCORE);
+                if (lineIndex > 0) beta = std::min(beta, ceiling + 1);
+            }
+
+            rootMoveHint = lineIndex > 0 && lineIndex < (int)lines.size() ? lines[lineIndex].pv[0] : Move();
+
+            int score;
+            while (true)
+            {
+                score = negamax(depth, 0, alpha, beta, true);
+                if (completedDepth > 0 && isStopped()) break;
+
+                if (score <= alpha)
+                {
+                    ++stats.aspirationFailLows;
+                    beta = (alpha + beta) / 2;
+                    alpha = std::max(score - delta, -Search::INFINITE_SCORE);
+                }
+                else if (score >= beta)
+                {
+                    ++stats.aspirationFailHighs;
+                    beta = std::min(score + delta, (int)Search::INFINITE_SCORE);
+                }
+                else break;
+
+                delta += delta / 2;
+            }
+
+            if (depth > 1 && isStopped()) break;
+            if (pvLength[0] == 0) break;
+
+            Search::Line line;
+            line.score = score;
+            line.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+            iterationLines.push_back(line);
+            excludedRootMoves.push_back(pvTable[0][0]);
+        }
+        excludedRootMoves.clear();
+
+        if (depth > 1 && isStopped()) break;
+        if (iterationLines.empty()) break;
+
+        // Search instability can leave a later line slightly above an earlier one
+        std::stable_sort(iterationLines.begin(), iterationLines.end(),
+            [](const Search::Line& a, const Search::Line& b) { return a.score > b.score; });
+        lines = iterationLines;
+
+        bestScore = lines[0].score;
+        bestMove = lines[0].pv[0];
+        completedDepth = depth;
+        pv = lines[0].pv;
+
+        if (id == 0 && search.infoCallback)
+        {
+            for (size_t i = 0; i != lines.size(); ++i)
+            {
+                Search::Info info;
+                info.depth = depth;
+                info.multiPv = (int)i + 1;
+                info.score = lines[i].score;
+                info.nodes = search.getNodes();
+                info.timeMs = search.getElapsedMs();
+                info.pv = lines[i].pv;
+                search.infoCallback(info);
+            }
+        }
+
+        if (isStopped()) break;
+
+        if (id == 0 && search.timeManager.isEnabled())
+        {
+            const uint64_t iterationNodes = getNodes() - iterationStartNodes;
+            const double effort = iterationNodes > 0 ? (double)bestMoveNodes / iterationNodes : 0.0;
+            if (search.timeManager.shouldStop(depth, bestMove, bestScore, effort, search.getElapsedMs()))
+            {
+                // While pondering the search goes on, but a ponder hit will end it straight away
+                if (!search.isPondering()) break;
+                search.stopOnPonderHit.store(true);
+                if (!search.isPondering()) break; // The hit came in between
+            }
+        }
+    }
+
+    stats.pawnProbes = pawnTable.getProbes();
+    stats.pawnHits = pawnTable.getHits();
+}
+
+int SearchThread::negamax(int depth, int ply, int alpha, int beta, bool pvNode)
+{
+    pvLength[ply] = 0;
+    countNode();
+
+    // Depth 1 always runs to completion so there is a move to play
+    if (completedDepth > 0 && isStopped()) return 0;
+    if (ply > 0 && (position.isRepetition() || position.getHalfmoveClock() >= 100)) return 0;
+    if (ply >= Search::MAX_PLY) return position.evaluate(pawnTable, materialTable);
+    if (depth <= 0) return quiescence(ply, alpha, beta);
+
+    const uint64_t key = position.getHashKey();
+    TranspositionTable::Data ttData;
+    Move ttMove;
+    if (search.tt.probe(key, ttData))
+    {
+        ttMove = ttData.move;
+        const int ttScore = scoreFromTT(ttData.score, ply);
+        if (ply > 0 && ttData.depth >= depth)
+        {
+            if (ttData.bound == TranspositionTable::BOUND_EXACT) return ttScore;
+            if (ttData.bound == TranspositionTable::BOUND_LOWER && ttScore >= beta) return ttScore;
+            if (ttData.bound == TranspositionTable::BOUND_UPPER && ttScore <= alpha) return ttScore;
+        }
+    }
+
+    // Right after a capture or pawn move, with few enough pieces left, the tablebases know the result.
+    // Wins and losses are only bounds, as the search may find a mate that is better than any tablebase score.
+    if (ply > 0 && search.probeTablebases && position.getHalfmoveClock() == 0 && search.tablebases->canProbe(position))
+    {
+        int wdl;
+        if (search.tablebases->probeWdl(position, wdl))
+        {
+            ++stats.tbHits;
+            const int score = wdl > 1 ? Search::TB_WIN_SCORE - ply : (wdl < -1 ? -Search::TB_WIN_SCORE + ply : 0);
+            const int bound = wdl > 1 ? TranspositionTable::BOUND_LOWER : (wdl < -1 ? TranspositionTable::BOUND_UPPER : TranspositionTable::BOUND_EXACT);
+
+            if (bound == TranspositionTable::BOUND_EXACT || (bound == TranspositionTable::BOUND_LOWER && score >= beta)
+                || (bound == TranspositionTable::BOUND_UPPER && score <= alpha))
+            {
+                search.tt.store(key, std::min(depth + 6, Search::MAX_PLY - 1), scoreToTT(score, ply), bound, Move());
+                return score;
+            }
+        }
+    }
+
+    const Search::Options& options = search.options;
+    const int color = position.getTurn();
+    const bool inCheck = position.isInCheck(color);
+    const int staticEval = inCheck ? -Search::INFINITE_SCORE : position.evaluate(pawnTable, materialTable);
+    const bool betaIsMate = std::abs(beta) >= Search::MATE_SCORE - Search::MAX_PLY;
+
+    // Node level pruning, never at PV nodes or in check
+    if (!pvNode && !inCheck)
+    {
+        // A mate threat against the king is invisible to the static evaluation and to the shallow search after a
+        // null move, so neither is trusted then. Only worked out where one of them could prune.
+        const bool threatened = staticEval >= beta && position.isThreatened(color);
+
+        // Reverse futility: the static evaluation is so far above beta that a quiet move is not going to lose it all
+        const int reverseFutilityMargin = REVERSE_FUTILITY_MARGIN * depth + REVERSE_FUTILITY_GROWTH * depth * depth;
+        if (options.reverseFutility && depth <= REVERSE_FUTILITY_DEPTH && !betaIsMate && !threatened && staticEval - reverseFutilityMargin >= beta)
+        {
+            return staticEval;
+        }
+
+        // Razoring: far below alpha near the leaves, check that only a capture could help
+        if (options.razoring && depth <= 2 && staticEval + RAZOR_MARGIN * depth < alpha)
+        {
+            const int score = quiescence(ply, alpha, alpha + 1);
+            if (score <= alpha) return score;
+        }
+
+        // Null move: if passing still fails high, a real move almost certainly would too.
+        // Without pieces other than pawns passing may be the best move (zugzwang), so it is skipped.
+        const int nonPawnPieces = position.getNonPawnPieceCount(color);
+        const bool previousWasNull = ply > 0 && stack[ply - 1].currentMove.originPiece == 0;
+        if (options.nullMove && depth >= 3 && staticEval >= beta && !threatened && !betaIsMate && nonPawnPieces > 0 && !previousWasNull && ply >= nullMoveMinPly)
+        {
+            const int reduction = 3 + depth / 6;
+
+            stack[ply].currentMove = Move();
+            position.makeNullMove();
+            int score = -negamax(depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+            position.undoNullMove();
+
+            if (completedDepth > 0 && isStopped()) return 0;
+
+            if (score >= beta)
+            {
+                if (score >= Search::MATE_SCORE - Search::MAX_PLY) score = beta;
+
+                // With a single piece left zugzwang is likely, so verify with a reduced search that cannot pass
+                if (nonPawnPieces > 1 || depth < NULL_MOVE_VERIFICATION_DEPTH) return score;
+
+                nullMoveMinPly = ply + 3 * (depth - reduction) / 4;
+                const int verification = negamax(depth - reduction, ply, beta - 1, beta, false);
+                nullMoveMinPly = 0;
+
+                if (verification >= beta) return score;
+            }
+        }
+    }
+
+    std::vector<Move>& moves = stack[ply].moves;
+    position.getLegalMoves(moves);
+
+    if (moves.empty())
+    {
+        return inCheck ? -Search::MATE_SCORE + ply : 0;
+    }
+
+    if (ply == 0 && rootMoveHint.originPiece != 0 && !isExcludedRootMove(rootMoveHint)) ttMove = rootMoveHint;
+
+    scoreMoves(ply, ttMove);
+
+    const int originalAlpha = alpha;
+    int bestScore = -Search::INFINITE_SCORE;
+    Move bestMove;
+    int movesSearched = 0;
+    stack[ply].quietsTried.clear();
+
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        const Move move = pickNextMove(ply, i);
+        if (ply == 0 && isExcludedRootMove(move)) continue;
+        const bool isQuiet = !Engine::isCapture(move) && move.promotion == 0;
+        const int moveNumber = (int)i + 1;
+
+        // Move level pruning near the leaves, once there is a move that does not lose
+        const bool canPrune = !pvNode && !inCheck && i > 0 && bestScore > -Search::MATE_SCORE + Search::MAX_PLY;
+        if (canPrune && depth <= 3)
+        {
+            // Late move pruning: after enough quiet moves the rest are very unlikely to matter
+            if (options.lateMovePruning && isQuiet && moveNumber > 3 + depth * depth) continue;
+
+            // Captures that lose too much in the exchange
+            if (options.seePruning && !isQuiet && !position.seeGE(move, -SEE_PRUNE_MARGIN * depth)) continue;
+        }
+
+        stack[ply].currentMove = move;
+        const uint64_t nodesBefore = ply == 0 ? getNodes() : 0;
+        position.makePseudoLegalMove(move);
+        const bool givesCheck = position.isInCheck(position.getTurn());
+
+        // Futility: a quiet move cannot bring a hopeless static evaluation back up to alpha
+        if (canPrune && options.futility && isQuiet && !givesCheck && depth <= 3 && staticEval + FUTILITY_MARGIN * depth <= alpha)
+        {
+            position.undoMove(move);
+            continue;
+        }
+
+        int score;
+
+        // Late move reductions: moves ordered late are searched shallower first and only re-searched if they beat alpha
+        int reduction = 0;
+        if (options.lateMoveReductions && depth >= 3 && moveNumber > (pvNode ? 3 : 2) && isQuiet && !inCheck && !givesCheck)
+        {
+            reduction = lmrTable[std::min(depth, 63)][std::min(moveNumber, 63)];
+            if (pvNode) reduction -= 1;
+            reduction = std::max(0, std::min(reduction, depth - 2));
+        }
+
+        // Principal variation search: the first move gets the full window. The rest get a null window that
+        // only proves they are no better than alpha, and are re-searched in full if they turn out to be.
+        // Excluded root moves are skipped before this, so the first move searched need not be the first one picked.
+        const bool isFirstSearched = movesSearched == 0;
+        if (isFirstSearched)
+        {
+            score = -negamax(depth - 1, ply + 1, -beta, -alpha, pvNode);
+        }
+        else
+        {
+            score = -negamax(depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, false);
+            if (score > alpha && reduction > 0)
+            {
+                ++stats.lmrResearches;
+                score = -negamax(depth - 1, ply + 1, -alpha - 1, -alpha, false);
+            }
+            if (score > alpha && score < beta && pvNode)
+            {
+                ++stats.pvsResearches;
+                score = -negamax(depth - 1, ply + 1, -beta, -alpha, true);
+            }
+        }
+        position.undoMove(move);
+        ++movesSearched;
+
+        if (completedDepth > 0 && isStopped()) return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = move;
+
+            if (score > alpha)
+            {
+                alpha = score;
+                updatePv(ply, move);
+                if (ply == 0) bestMoveNodes = getNodes() - nodesBefore;
+
+                if (alpha >= beta)
+                {
+                    ++stats.cutoffs;
+                    if (isFirstSearched) ++stats.firstMoveCutoffs;
+                    if (isQuiet) updateQuietStats(ply, depth, move);
+                    break;
+                }
+            }
+        }
+
+        if (isQuiet) stack[ply].quietsTried.push_back(move);
+    }
+
+    // Every move was pruned
+    if (bestScore == -Search::INFINITE_SCORE) bestScore = alpha;
+
+    const int bound = bestScore >= beta ? TranspositionTable::BOUND_LOWER
+        : (bestScore > originalAlpha ? TranspositionTable::BOUND_EXACT : TranspositionTable::BOUND_UPPER);
+    // A root search with moves left out has not seen the whole position
+    if (ply > 0 || (excludedRootMoves.empty() && search.tablebaseRootMoves.empty())) search.tt.store(key, depth, scoreToTT(bestScore, ply), bound, bestMove);
+
+    return bestScore;
+}
+
+bool SearchThread::isExcludedRootMove(const Move& move) const
+{
+    const std::vector<Move>& allowed = search.tablebaseRootMoves;
+    if (!allowed.empty() && std::find(allowed.begin(), allowed.end(), move) == allowed.end()) return true;
+    return std::find(excludedRootMoves.begin(), excludedRootMoves.end(), move) != excludedRootMoves.end();
+}
+
+int SearchThread::quiescence(int ply, int alpha, int beta)
+{
+    pvLength[ply] = 0;
+    countNode();
+    ++stats.qnodes;
+
+    if (completedDepth > 0 && isStopped()) return 0;
+    if (ply >= Search::MAX_PLY) return position.evaluate(pawnTable, materialTable);
+
+    const bool inCheck = position.isInCheck(position.getTurn());
+    std::vector<Move>& moves = stack[ply].moves;
+    int bestScore = -Search::INFINITE_SCORE;
+    int standPat = 0;
+
+    if (inCheck)
+    {
+        // Standing pat is not an option in check, so every evasion is searched
+        position.getLegalMoves(moves);
+        if (moves.empty()) return -Search::MATE_SCORE + ply;
+    }
+    else
+    {
+        standPat = position.evaluate(pawnTable, materialTable);
+        if (standPat >= beta) return standPat;
+        if (standPat > alpha) alpha = standPat;
+        bestScore = standPat;
+
+        position.getLegalCaptures(moves);
+    }
+
+    scoreMoves(ply, Move());
+
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        const Move move = pickNextMove(ply, i);
+
+        if (!inCheck)
+        {
+            // Delta pruning: winning the piece for free would still not raise alpha
+            if (standPat + Engine::getMoveGain(move) + DELTA_MARGIN <= alpha) continue;
+
+            // Captures that lose material in the exchange are not worth searching.
+            // scoreMoves already ran SEE and put them below zero.
+            if (stack[ply].moveScores[i] < 0) continue;
+        }
+
+        stack[ply].currentMove = move;
+        position.makePseudoLegalMove(move);
+        const int score = -quiescence(ply + 1, -beta, -alpha);
+        position.undoMove(move);
+
+        if (completedDepth > 0 && isStopped()) return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                updatePv(ply, move);
+                if (alpha >= beta) break;
+            }
+        }
+    }
+
+    return bestScore;
+}
+
+void SearchThread::updatePv(int ply, const Move& move)
+{
+    pvTable[ply][0] = move;
+    for (int j = 0; j != pvLength[ply + 1]; ++j) pvTable[ply][j + 1] = pvTable[ply + 1][j];
+    pvLength[ply] = pvLength[ply + 1] + 1;
+}
+
+void SearchThread::scoreMoves(int ply, const Move& ttMove)
+{
+    const std::vector<Move>& moves = stack[ply].moves;
+    std::vector<int>& scores = stack[ply].moveScores;
+    scores.resize(moves.size());
+
+    const int color = position.getTurn();
+    const uint16_t killer1 = killers[ply][0];
+    const uint16_t killer2 = killers[ply][1];
+    uint16_t counterMove = 0;
+    if (ply > 0 && stack[ply - 1].currentMove.originPiece != 0)
+    {
+        const Move& previous = stack[ply - 1].currentMove;
+        counterMove = counterMoves[previous.originPiece - 1][previous.targetIndex];
+    }
+
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        const Move& move = moves[i];
+        const uint16_t packed = move.pack();
+        int score;
+
+        if (move == ttMove) score = 1 << 24;
+        else if (Engine::isCapture(move) || move.promotion == Engine::QUEEN)
+        {
+            // MVV-LVA: most valuable victim first, then least valuable attacker. A queen promotion counts as winning the difference.
+            // Captures that lose the exchange go after the quiet moves.
+            const int attackerValue = Engine::getPieceValue(move.originPiece);
+            const int attackerRank = attackerValue == 0 ? 10 : attackerValue / 100; // King captures last
+            const int mvvLva = Engine::getMoveGain(move) * 10 - attackerRank;
+            score = position.seeGE(move, 0) ? (1 << 20) + mvvLva : -(1 << 20) + mvvLva;
+        }
+        else if (packed == killer1) score = (1 << 19) + 1;
+        else if (packed == killer2) score = 1 << 19;
+        else if (packed == counterMove) score = 1 << 18;
+        else
+        {
+            score = history[color][move.originIndex][move.targetIndex];
+
+            // Helpers break ties differently from the main thread
+            if (id != 0) score += (int)(nextRandom() & 15);
+        }
+
+        scores[i] = score;
+    }
+}
+
+const Move& SearchThread::pickNextMove(int ply, size_t index)
+{
+    // Selection sort one step at a time, since a cutoff often comes before the list is exhausted
+    std::vector<Move>& moves = stack[ply].moves;
+    std::vector<int>& scores = stack[ply].moveScores;
+
+    size_t best = index;
+    for (size_t i = index + 1; i < moves.size(); ++i)
+    {
+        if (scores[i] > scores[best]) best = i;
+    }
+    if (best != index)
+    {
+        std::swap(moves[index], moves[best]);
+        std::swap(scores[index], scores[best]);
+    }
+    return moves[index];
+}
+
+void SearchThread::updateQuietStats(int ply, int depth, const Move& move)
+{
+    const uint16_t packed = move.pack();
+    if (killers[ply][0] != packed)
+    {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = packed;
+    }
+
+    // Reward the move that caused the cutoff and penalise the quiet moves tried before it
+    const int color = position.getTurn();
+    const int bonus = std::min(depth * depth, 400);
+    updateHistory(color, move, bonus);
+    for (const Move& quiet : stack[ply].quietsTried) updateHistory(color, quiet, -bonus);
+
+    if (ply > 0 && stack[ply - 1].currentMove.originPiece != 0)
+    {
+        const Move& previous = stack[ply - 1].currentMove;
+        counterMoves[previous.originPiece - 1][previous.targetIndex] = packed;
+    }
+}
+
+void SearchThread::updateHistory(int color, const Move& move, int bonus)
+{
+    // Gravity keeps the score within +-MAX_HISTORY so it fits in 16 bits
+    int16_t& entry = history[color][move.originIndex][move.targetIndex];
+    entry = (int16_t)(entry + bonus - entry * std::abs(bonus) / MAX_HISTORY);
+}
+
+void SearchThread::resetOrderingTables()
+{
+    // Killers are position specific, but history and countermoves are still useful after a move is played
+    std::memset(killers, 0, sizeof(killers));
+    for (auto& byOrigin : history)
+    for (auto& byTarget : byOrigin)
+    for (int16_t& entry : byTarget) entry /= 2;
+}
+
+int SearchThread::scoreToTT(int score, int ply)
+{
+    if (score >= Search::TB_WIN_SCORE - Search::MAX_PLY) return score + ply;
+    if (score <= -Search::TB_WIN_SCORE + Search::MAX_PLY) return score - ply;
+    return score;
+}
+
+int SearchThread::scoreFromTT(int score, int ply)
+{
+    if (score >= Search::TB_WIN_SCORE - Search::MAX_PLY) return score - ply;
+    if (score <= -Search::TB_WIN_SCORE + Search::MAX_PLY) return score + ply;
+    return score;
+}
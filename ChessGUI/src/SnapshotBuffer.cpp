@@ -0,0 +1,38 @@
+#include "SnapshotBuffer.h"
+#include <thread>
+
+SnapshotBuffer::SnapshotBuffer() : front(0), inUse(-1), back(1)
+{
+}
+
+PositionSnapshot& SnapshotBuffer::beginWrite()
+{
+    // Only wait if the reader still holds the buffer from two publishes ago
+    back = 1 - front.load();
+    while (inUse.load() == back) std::this_thread::yield();
+    return buffers[back];
+}
+
+void SnapshotBuffer::publish()
+{
+    front.store(back);
+}
+
+const PositionSnapshot& SnapshotBuffer::acquire()
+{
+    // Marking the buffer and checking it is still the front makes sure the writer sees the mark before reusing it
+    int index = front.load();
+    while (true)
+    {
+        inUse.store(index);
+        const int current = front.load();
+        if (current == index) break;
+        index = current;
+    }
+    return buffers[index];
+}
+
+void SnapshotBuffer::release()
+{
+    inUse.store(-1);
+}
@@ -0,0 +1,712 @@
+#include "SyzygyTable.h"
+#include <Engine.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Tablebase pieces by engine piece. Pawn to king are 1 to 6, black adds 8.
+static const int tablePieces[13] = { 0, 6, 5, 3, 2, 4, 1, 14, 13, 11, 10, 12, 9 };
+static const int TABLE_PAWN = 1;
+static const int TABLE_KING = 6;
+
+// The files are little-endian apart from the compressed blocks, which are read as big-endian words
+static uint16_t readLittle16(const unsigned char* data)
+{
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t readLittle32(const unsigned char* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint32_t readBig32(const unsigned char* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+static uint64_t readBig64(const unsigned char* data)
+{
+    return ((uint64_t)readBig32(data) << 32) | readBig32(data + 4);
+}
+
+int SyzygyTable::mapPawns[64];
+int SyzygyTable::mapB1H1H7[64];
+int SyzygyTable::mapA1D1D4[64];
+int SyzygyTable::mapKK[10][64];
+uint64_t SyzygyTable::binomial[6][64];
+int SyzygyTable::leadPawnIndex[6][64];
+int SyzygyTable::leadPawnsSize[6][4];
+
+int SyzygyTable::offDiagonal(int square)
+{
+    return (square >> 3) - (square & 7);
+}
+
+void SyzygyTable::initEncodingTables()
+{
+    // Squares below the a1-h8 diagonal, 0 to 27
+    int code = 0;
+    for (int square = 0; square != 64; ++square)
+    {
+        if (offDiagonal(square) < 0) mapB1H1H7[square] = code++;
+    }
+
+    // Squares of the a1-d1-d4 triangle, 0 to 9, with the diagonal last
+    std::vector<int> diagonal;
+    code = 0;
+    for (int square = 0; square <= 27; ++square)
+    {
+        if ((square & 7) > 3) continue;
+        if (offDiagonal(square) < 0) mapA1D1D4[square] = code++;
+        else if (offDiagonal(square) == 0) diagonal.push_back(square);
+    }
+    for (int square : diagonal) mapA1D1D4[square] = code++;
+
+    // The 462 ways to place two kings with the first in the triangle. If the first is on the diagonal the second
+    // is not above it, and positions with both on the diagonal come last.
+    std::vector<std::pair<int, int>> bothOnDiagonal;
+    code = 0;
+    for (int index = 0; index != 10; ++index)
+    for (int first = 0; first <= 27; ++first)
+    {
+        if ((first & 7) > 3 || mapA1D1D4[first] != index || (index == 0 && first != 1)) continue; // b1 is 0
+
+        for (int second = 0; second != 64; ++second)
+        {
+            const bool adjacent = std::abs((first & 7) - (second & 7)) <= 1 && std::abs((first >> 3) - (second >> 3)) <= 1;
+            if (adjacent) continue;
+            if (offDiagonal(first) == 0 && offDiagonal(second) > 0) continue;
+
+            if (offDiagonal(first) == 0 && offDiagonal(second) == 0) bothOnDiagonal.push_back({ index, second });
+            else mapKK[index][second] = code++;
+        }
+    }
+    for (const auto& kings : bothOnDiagonal) mapKK[kings.first][kings.second] = code++;
+
+    binomial[0][0] = 1;
+    for (int n = 1; n != 64; ++n)
+    for (int k = 0; k != 6 && k <= n; ++k)
+    {
+        binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+    }
+
+    // Pawns on a2-h7 map to 47 down to 0, so the leading pawn, the one with the highest value, is the one
+    // nearest the edge and lowest on its file. The leading pawns are indexed per file of the first of them.
+    int available = 47;
+    for (int leadPawns = 1; leadPawns <= 5; ++leadPawns)
+    for (int file = 0; file != 4; ++file)
+    {
+        int index = 0;
+        for (int rank = 1; rank <= 6; ++rank)
+        {
+            const int square = rank * 8 + file;
+            if (leadPawns == 1)
+            {
+                mapPawns[square] = available--;
+                mapPawns[square ^ 7] = available--;
+            }
+            leadPawnIndex[leadPawns][square] = index;
+            index += (int)binomial[leadPawns - 1][mapPawns[square]];
+        }
+        leadPawnsSize[leadPawns][file] = index;
+    }
+}
+
+SyzygyTable::SyzygyTable(int type, const std::string& path, const int counts[2][7]) : type(type), path(path), mapped(false), dtzMap(nullptr)
+{
+    static const bool tablesReady = (initEncodingTables(), true);
+    (void)tablesReady;
+
+    int mirrored[2][7];
+    for (int piece = 0; piece != 7; ++piece)
+    {
+        mirrored[0][piece] = counts[1][piece];
+        mirrored[1][piece] = counts[0][piece];
+    }
+    key = getMaterialKey(counts);
+    mirroredKey = getMaterialKey(mirrored);
+
+    pieceCount = 0;
+    hasUniquePieces = false;
+    for (int color = 0; color != 2; ++color)
+    for (int piece = TABLE_PAWN; piece <= TABLE_KING; ++piece)
+    {
+        pieceCount += counts[color][piece];
+        if (piece != TABLE_KING && counts[color][piece] == 1) hasUniquePieces = true;
+    }
+    hasPawns = counts[0][TABLE_PAWN] + counts[1][TABLE_PAWN] > 0;
+
+    // The pawns of the side with fewer of them lead, as that compresses better
+    const int white = counts[0][TABLE_PAWN], black = counts[1][TABLE_PAWN];
+    const bool whiteLeads = black == 0 || (white != 0 && black >= white);
+    pawnCounts[0] = whiteLeads ? white : black;
+    pawnCounts[1] = whiteLeads ? black : white;
+}
+
+bool SyzygyTable::map()
+{
+    if (mapped) return true;
+    if (!file.open(path)) return false;
+
+    static const unsigned char magics[2][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+    const unsigned char* data = file.getData();
+    const size_t size = file.getSize();
+    if (size % 64 != 16 || std::memcmp(data, magics[type], 4) != 0 || !parse(data + 4, data + size))
+    {
+        file.close();
+        return false;
+    }
+
+    mapped = true;
+    return true;
+}
+
+void SyzygyTable::unmap()
+{
+    file.close();
+    mapped = false;
+}
+
+bool SyzygyTable::isMapped() const
+{
+    return mapped;
+}
+
+uint64_t SyzygyTable::getKey() const
+{
+    return key;
+}
+
+uint64_t SyzygyTable::getMirroredKey() const
+{
+    return mirroredKey;
+}
+
+int SyzygyTable::getPieceCount() const
+{
+    return pieceCount;
+}
+
+bool SyzygyTable::parseName(const std::string& name, int counts[2][7])
+{
+    std::memset(counts, 0, sizeof(int) * 2 * 7);
+
+    int color = 0;
+    int total = 0;
+    for (char c : name)
+    {
+        if (c == 'v')
+        {
+            if (color == 1) return false;
+            color = 1;
+            continue;
+        }
+
+        const char* letters = "PNBRQK";
+        const char* letter = std::strchr(letters, c);
+        if (c == 0 || letter == nullptr) return false;
+        ++counts[color][letter - letters + 1];
+        ++total;
+    }
+    return color == 1 && counts[0][TABLE_KING] == 1 && counts[1][TABLE_KING] == 1 && total <= MAX_PIECES;
+}
+
+uint64_t SyzygyTable::getMaterialKey(const int counts[2][7])
+{
+    // A nibble for each piece's count
+    uint64_t materialKey = 0;
+    for (int color = 0; color != 2; ++color)
+    for (int piece = TABLE_PAWN; piece <= TABLE_KING; ++piece)
+    {
+        materialKey += (uint64_t)counts[color][piece] << (4 * (piece + 8 * color));
+    }
+    return materialKey;
+}
+
+uint64_t SyzygyTable::getMaterialKey(const Engine& position)
+{
+    const std::vector<Bitboard>& piecePositions = position.getPiecePositions();
+    uint64_t materialKey = 0;
+    for (int piece = 1; piece <= 12; ++piece)
+    {
+        materialKey += (uint64_t)piecePositions[piece - 1].popCount() << (4 * tablePieces[piece]);
+    }
+    return materialKey;
+}
+
+SyzygyTable::PairsData& SyzygyTable::getPairs(int side, int file)
+{
+    return items[type == WDL ? side : 0][hasPawns ? file : 0];
+}
+
+const SyzygyTable::PairsData& SyzygyTable::getPairs(int side, int file) const
+{
+    return items[type == WDL ? side : 0][hasPawns ? file : 0];
+}
+
+int SyzygyTable::getLeftSymbol(const PairsData& pairs, int symbol)
+{
+    const unsigned char* node = pairs.symbolTree + 3 * symbol;
+    return ((node[1] & 0xF) << 8) | node[0];
+}
+
+int SyzygyTable::getRightSymbol(const PairsData& pairs, int symbol)
+{
+    const unsigned char* node = pairs.symbolTree + 3 * symbol;
+    return (node[2] << 4) | (node[1] >> 4);
+}
+
+bool SyzygyTable::parse(const unsigned char* data, const unsigned char* end)
+{
+    const unsigned char* base = file.getData();
+    auto align = [base](const unsigned char* pointer, size_t alignment) {
+        return base + ((size_t)(pointer - base) + alignment - 1) / alignment * alignment;
+    };
+
+    // Flags: the table is split by side to move, and it has pawns
+    const int split = 1, pawns = 2;
+    if (((*data & pawns) != 0) != hasPawns) return false;
+    if (((*data & split) != 0) != (key != mirroredKey)) return false;
+    ++data;
+
+    const int sides = type == WDL && key != mirroredKey ? 2 : 1;
+    const int maxFile = hasPawns ? 3 : 0;
+    const bool pawnsOnBothSides = hasPawns && pawnCounts[1] > 0;
+
+    // Order the groups are encoded in and the pieces of each group, low nibble for the first side
+    for (int file = 0; file <= maxFile; ++file)
+    {
+        for (int side = 0; side != sides; ++side) getPairs(side, file) = PairsData();
+
+        const int order[2][2] = {
+            { *data & 0xF, pawnsOnBothSides ? data[1] & 0xF : 0xF },
+            { *data >> 4, pawnsOnBothSides ? data[1] >> 4 : 0xF } };
+        data += 1 + pawnsOnBothSides;
+
+        for (int i = 0; i != pieceCount; ++i, ++data)
+        for (int side = 0; side != sides; ++side)
+        {
+            getPairs(side, file).pieces[i] = side ? *data >> 4 : *data & 0xF;
+        }
+
+        for (int side = 0; side != sides; ++side) setGroups(getPairs(side, file), order[side], file);
+    }
+    data = align(data, 2);
+
+    for (int file = 0; file <= maxFile; ++file)
+    for (int side = 0; side != sides; ++side)
+    {
+        data = setSizes(getPairs(side, file), data);
+        if (data == nullptr || data > end) return false;
+    }
+
+    // DTZ values can go through a map, one for each kind of result
+    if (type == DTZ)
+    {
+        dtzMap = data;
+        for (int file = 0; file <= maxFile; ++file)
+        {
+            PairsData& pairs = getPairs(0, file);
+            if (!(pairs.flags & FLAG_MAPPED)) continue;
+
+            for (int i = 0; i != 4; ++i)
+            {
+                if (pairs.flags & FLAG_WIDE)
+                {
+                    if (i == 0) data = align(data, 2);
+                    pairs.mapIndex[i] = (uint16_t)((data - dtzMap) / 2 + 1);
+                    data += 2 * (size_t)readLittle16(data) + 2;
+                }
+                else
+                {
+                    pairs.mapIndex[i] = (uint16_t)(data - dtzMap + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+        data = align(data, 2);
+    }
+
+    for (int file = 0; file <= maxFile; ++file)
+    for (int side = 0; side != sides; ++side)
+    {
+        PairsData& pairs = getPairs(side, file);
+        pairs.sparseIndex = data;
+        data += pairs.sparseIndexSize * 6;
+    }
+
+    for (int file = 0; file <= maxFile; ++file)
+    for (int side = 0; side != sides; ++side)
+    {
+        PairsData& pairs = getPairs(side, file);
+        pairs.blockLengths = data;
+        data += (size_t)pairs.blockLengthCount * 2;
+    }
+
+    for (int file = 0; file <= maxFile; ++file)
+    for (int side = 0; side != sides; ++side)
+    {
+        PairsData& pairs = getPairs(side, file);
+        data = align(data, 64);
+        pairs.data = data;
+        data += (size_t)pairs.blockCount * pairs.blockSize;
+    }
+
+    return data <= end;
+}
+
+void SyzygyTable::setGroups(PairsData& pairs, const int order[2], int file)
+{
+    // Pieces of the same kind next to each other form a group, except that the leading group takes the first
+    // two or three pieces when there are no pawns, e.g. KRvKN with unique pieces is 111 then 1, so (3, 1)
+    int groups = 0;
+    int firstLength = hasPawns ? 0 : (hasUniquePieces ? 3 : 2);
+    pairs.groupLength[0] = 1;
+    for (int i = 1; i < pieceCount; ++i)
+    {
+        if (--firstLength > 0 || pairs.pieces[i] == pairs.pieces[i - 1]) ++pairs.groupLength[groups];
+        else pairs.groupLength[++groups] = 1;
+    }
+    pairs.groupLength[++groups] = 0;
+
+    // A position's index is g1 * N(g2) * N(g3) + g2 * N(g3) + g3, where N(g) is the number of ways to place group g.
+    // The leading group and the other side's pawns are at the positions order gives, the rest in turn.
+    const bool pawnsOnBothSides = hasPawns && pawnCounts[1] > 0;
+    int next = pawnsOnBothSides ? 2 : 1;
+    int freeSquares = 64 - pairs.groupLength[0] - (pawnsOnBothSides ? pairs.groupLength[1] : 0);
+    uint64_t index = 1;
+
+    for (int k = 0; next < groups || k == order[0] || k == order[1]; ++k)
+    {
+        if (k == order[0])
+        {
+            pairs.groupIndex[0] = index;
+            index *= hasPawns ? leadPawnsSize[pairs.groupLength[0]][file] : (hasUniquePieces ? 31332 : 462);
+        }
+        else if (k == order[1])
+        {
+            pairs.groupIndex[1] = index;
+            index *= binomial[pairs.groupLength[1]][48 - pairs.groupLength[0]];
+        }
+        else
+        {
+            pairs.groupIndex[next] = index;
+            index *= binomial[pairs.groupLength[next]][freeSquares];
+            freeSquares -= pairs.groupLength[next++];
+        }
+    }
+    pairs.groupIndex[groups] = index;
+}
+
+const unsigned char* SyzygyTable::setSizes(PairsData& pairs, const unsigned char* data)
+{
+    pairs.flags = *data++;
+
+    if (pairs.flags & FLAG_SINGLE_VALUE)
+    {
+        pairs.blockCount = 0;
+        pairs.span = 0;
+        pairs.blockLengthCount = 0;
+        pairs.sparseIndexSize = 0;
+        pairs.minSymbolLength = *data++; // The value every position has
+        return data;
+    }
+
+    // The last group index is the number of positions in the table
+    const int groups = (int)(std::find(pairs.groupLength, pairs.groupLength + MAX_PIECES, 0) - pairs.groupLength);
+    const uint64_t tableSize = pairs.groupIndex[groups];
+
+    pairs.blockSize = (size_t)1 << *data++;
+    pairs.span = (size_t)1 << *data++;
+    pairs.sparseIndexSize = (size_t)((tableSize + pairs.span - 1) / pairs.span);
+    const int padding = *data++;
+    pairs.blockCount = readLittle32(data);
+    data += 4;
+    pairs.blockLengthCount = pairs.blockCount + padding; // Padded so the sparse index cannot point past the end
+    pairs.maxSymbolLength = *data++;
+    pairs.minSymbolLength = *data++;
+    pairs.lowestSymbols = data;
+    if (pairs.minSymbolLength < 1 || pairs.maxSymbolLength < pairs.minSymbolLength || pairs.maxSymbolLength > 32) return nullptr;
+
+    // Canonical Huffman code: longer symbols have lower values. base[i] is the lowest symbol of length
+    // minSymbolLength + i, left aligned so a code at the front of a 64 bit buffer is at least base[i] exactly when
+    // it is that long or shorter.
+    pairs.base.assign(pairs.maxSymbolLength - pairs.minSymbolLength + 1, 0);
+    for (int i = (int)pairs.base.size() - 2; i >= 0; --i)
+    {
+        pairs.base[i] = (pairs.base[i + 1] + readLittle16(pairs.lowestSymbols + 2 * i) - readLittle16(pairs.lowestSymbols + 2 * (i + 1))) / 2;
+    }
+    for (size_t i = 0; i != pairs.base.size(); ++i)
+    {
+        pairs.base[i] <<= 64 - i - pairs.minSymbolLength;
+    }
+    data += pairs.base.size() * 2;
+
+    // Recursive pairing: every symbol is a value or stands for a pair of other symbols
+    pairs.symbolLengths.assign(readLittle16(data), 0);
+    data += 2;
+    pairs.symbolTree = data;
+
+    std::vector<bool> visited(pairs.symbolLengths.size());
+    for (size_t symbol = 0; symbol != pairs.symbolLengths.size(); ++symbol)
+    {
+        if (!visited[symbol]) pairs.symbolLengths[symbol] = setSymbolLength(pairs, (int)symbol, visited);
+    }
+
+    return data + pairs.symbolLengths.size() * 3 + (pairs.symbolLengths.size() & 1);
+}
+
+uint8_t SyzygyTable::setSymbolLength(PairsData& pairs, int symbol, std::vector<bool>& visited)
+{
+    // The tree has no cycles, so a symbol can be marked before its children are done
+    visited[symbol] = true;
+    const int right = getRightSymbol(pairs, symbol);
+    if (right == 0xFFF) return 0;
+
+    const int left = getLeftSymbol(pairs, symbol);
+    const int count = (int)pairs.symbolLengths.size();
+    if (left >= count || right >= count) return 0;
+
+    if (!visited[left]) pairs.symbolLengths[left] = setSymbolLength(pairs, left, visited);
+    if (!visited[right]) pairs.symbolLengths[right] = setSymbolLength(pairs, right, visited);
+    return (uint8_t)(pairs.symbolLengths[left] + pairs.symbolLengths[right] + 1);
+}
+
+int SyzygyTable::decompress(const PairsData& pairs, uint64_t index) const
+{
+    if (pairs.flags & FLAG_SINGLE_VALUE) return pairs.minSymbolLength;
+
+    // Sparse index entry k points at the value with index k * span + span / 2. From there walk to the block
+    // holding the value, each block holding its length plus one values.
+    const uint64_t k = index / pairs.span;
+    const unsigned char* entry = pairs.sparseIndex + 6 * k;
+    uint32_t block = readLittle32(entry);
+    int offset = readLittle16(entry + 4);
+    offset += (int)(index % pairs.span) - (int)(pairs.span / 2);
+
+    while (offset < 0) offset += readLittle16(pairs.blockLengths + 2 * --block) + 1;
+    while (offset > readLittle16(pairs.blockLengths + 2 * block)) offset -= readLittle16(pairs.blockLengths + 2 * block++) + 1;
+
+    // Read symbols from the start of the block until the one that covers the offset
+    const unsigned char* pointer = pairs.data + (uint64_t)block * pairs.blockSize;
+    uint64_t buffer = readBig64(pointer);
+    pointer += 8;
+    int bufferBits = 64;
+    int symbol;
+
+    while (true)
+    {
+        int length = 0; // Above the minimum
+        while (buffer < pairs.base[length]) ++length;
+
+        // Symbols of one length are consecutive, starting from the lowest one of that length
+        symbol = (int)((buffer - pairs.base[length]) >> (64 - length - pairs.minSymbolLength));
+        symbol += readLittle16(pairs.lowestSymbols + 2 * length);
+
+        if (offset < pairs.symbolLengths[symbol] + 1) break;
+
+        offset -= pairs.symbolLengths[symbol] + 1;
+        length += pairs.minSymbolLength;
+        buffer <<= length;
+        bufferBits -= length;
+
+        if (bufferBits <= 32)
+        {
+            bufferBits += 32;
+            buffer |= (uint64_t)readBig32(pointer) << (64 - bufferBits);
+            pointer += 4;
+        }
+    }
+
+    // The symbol stands for several values. Pairs keep their values in order, so go left or right down the tree.
+    while (pairs.symbolLengths[symbol] != 0)
+    {
+        const int left = getLeftSymbol(pairs, symbol);
+        if (offset < pairs.symbolLengths[left] + 1) symbol = left;
+        else
+        {
+            offset -= pairs.symbolLengths[left] + 1;
+            symbol = getRightSymbol(pairs, symbol);
+        }
+    }
+
+    return getLeftSymbol(pairs, symbol);
+}
+
+int SyzygyTable::mapScore(int file, int value, int wdl) const
+{
+    if (type == WDL) return value - 2;
+
+    // Map for win, loss, cursed win and blessed loss, by result from -2 to 2
+    static const int wdlMap[5] = { 1, 3, 0, 2, 0 };
+    const PairsData& pairs = getPairs(0, file);
+    if (pairs.flags & FLAG_MAPPED)
+    {
+        const size_t index = (size_t)pairs.mapIndex[wdlMap[wdl + 2]] + value;
+        value = pairs.flags & FLAG_WIDE ? readLittle16(dtzMap + 2 * index) : dtzMap[index];
+    }
+
+    // Stored in moves unless the flags say plies. Results decided by the fifty move rule are always in moves.
+    if ((wdl == 2 && !(pairs.flags & FLAG_WIN_PLIES)) || (wdl == -2 && !(pairs.flags & FLAG_LOSS_PLIES)) || wdl == 1 || wdl == -1)
+    {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+int SyzygyTable::probe(const Engine& position, int wdl, bool& changeSide) const
+{
+    changeSide = false;
+
+    // Tables have the stronger side as white, and symmetric tables only have white to move.
+    // Other positions are looked up with the colors swapped and the board flipped.
+    const int turn = position.getTurn() == Engine::WHITE ? 0 : 1;
+    const bool flip = (key == mirroredKey && turn == 1) || getMaterialKey(position) != key;
+    const int flipColor = flip ? 8 : 0;
+    const int flipSquares = flip ? 56 : 0;
+    const int side = (flip ? 1 : 0) ^ turn;
+
+    const std::vector<int>& board = position.getBoard();
+    int squares[MAX_PIECES];
+    int pieces[MAX_PIECES];
+    int size = 0;
+    int leadPawnCount = 0;
+    int leadPawn = 0;
+    int file = 0;
+    auto byPawnMap = [](int a, int b) { return mapPawns[a] < mapPawns[b]; };
+
+    // Tables with pawns are split by the file of the leading pawn, the one nearest the edge and lowest on it.
+    // The pawns of its color come first.
+    if (hasPawns)
+    {
+        leadPawn = getPairs(0, 0).pieces[0] ^ flipColor;
+        for (int square = 0; square != 64 && size != MAX_PIECES; ++square)
+        {
+            if (tablePieces[board[square ^ 7]] == leadPawn) squares[size++] = square ^ flipSquares;
+        }
+        leadPawnCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnCount, byPawnMap));
+
+        file = squares[0] & 7;
+        if (file > 3) file = 7 - file;
+    }
+
+    // DTZ tables only have one side to move
+    const PairsData& pairs = getPairs(side, file);
+    if (type == DTZ && (pairs.flags & FLAG_STM) != side && !(key == mirroredKey && !hasPawns))
+    {
+        changeSide = true;
+        return 0;
+    }
+
+    // Board squares are h1 = 0, table squares a1 = 0
+    for (int square = 0; square != 64 && size != MAX_PIECES; ++square)
+    {
+        const int piece = tablePieces[board[square ^ 7]];
+        if (piece == 0 || (hasPawns && piece == leadPawn)) continue;
+        squares[size] = square ^ flipSquares;
+        pieces[size++] = piece ^ flipColor;
+    }
+
+    // Put the pieces in the table's order
+    for (int i = leadPawnCount; i < size - 1; ++i)
+    for (int j = i + 1; j < size; ++j)
+    {
+        if (pairs.pieces[i] == pieces[j])
+        {
+            std::swap(pieces[i], pieces[j]);
+            std::swap(squares[i], squares[j]);
+            break;
+        }
+    }
+
+    // Mirror so the leading piece is on files a to d
+    if ((squares[0] & 7) > 3)
+    {
+        for (int i = 0; i != size; ++i) squares[i] ^= 7;
+    }
+
+    uint64_t index;
+    if (hasPawns)
+    {
+        // The other leading pawns in ascending order
+        index = leadPawnIndex[leadPawnCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnCount, byPawnMap);
+        for (int i = 1; i < leadPawnCount; ++i) index += binomial[i][mapPawns[squares[i]]];
+    }
+    else
+    {
+        // Without pawns the board can also be flipped so the leading piece is on ranks 1 to 4,
+        // and mirrored in the diagonal so the first leading piece off it is below it
+        if ((squares[0] >> 3) > 3)
+        {
+            for (int i = 0; i != size; ++i) squares[i] ^= 56;
+        }
+
+        for (int i = 0; i != pairs.groupLength[0]; ++i)
+        {
+            if (offDiagonal(squares[i]) == 0) continue;
+            if (offDiagonal(squares[i]) > 0)
+            {
+                for (int j = i; j != size; ++j) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (hasUniquePieces)
+        {
+            // Three unique pieces are encoded together, skipping the squares taken by the ones before
+            const int adjust1 = squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offDiagonal(squares[0]))
+            {
+                index = ((uint64_t)mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            }
+            else if (offDiagonal(squares[1]))
+            {
+                index = ((uint64_t)6 * 63 + (squares[0] >> 3) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            }
+            else if (offDiagonal(squares[2]))
+            {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28 + ((squares[1] >> 3) - adjust1) * 28 + mapB1H1H7[squares[2]];
+            }
+            else
+            {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] >> 3) * 7 * 6 + ((squares[1] >> 3) - adjust1) * 6 + ((squares[2] >> 3) - adjust2);
+            }
+        }
+        else
+        {
+            index = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The remaining groups in ascending order, each square counted without the squares of the groups before it.
+    // The other side's pawns, if they come next, cannot be on the first or last rank.
+    index *= pairs.groupIndex[0];
+    int* groupSquares = squares + pairs.groupLength[0];
+    bool remainingPawns = hasPawns && pawnCounts[1] > 0;
+
+    for (int group = 1; pairs.groupLength[group] != 0; ++group)
+    {
+        const int length = pairs.groupLength[group];
+        std::stable_sort(groupSquares, groupSquares + length);
+
+        uint64_t groupIndex = 0;
+        for (int i = 0; i != length; ++i)
+        {
+            const int square = groupSquares[i];
+            const int adjust = (int)std::count_if(squares, groupSquares, [square](int other) { return square > other; });
+            groupIndex += binomial[i + 1][square - adjust - 8 * remainingPawns];
+        }
+
+        remainingPawns = false;
+        index += groupIndex * pairs.groupIndex[group];
+        groupSquares += length;
+    }
+
+    return mapScore(file, decompress(pairs, index), wdl);
+}
@@ -0,0 +1,418 @@
+#include "Tablebases.h"
+#include <Engine.h>
+#include <algorithm>
+#include <filesystem>
+
+Tablebases::Tablebases() : tableCount(0), maxPieces(0), maxMapped(DEFAULT_MAX_MAPPED), useCounter(0)
+{
+}
+
+int Tablebases::load(const std::string& paths)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mappedSlots.clear();
+    }
+    materialsByKey.clear();
+    materials.clear();
+    tableCount = 0;
+    maxPieces = 0;
+
+#ifdef _WIN32
+    const char separator = ';';
+#else
+    const char separator = ':';
+#endif
+
+    size_t start = 0;
+    while (start <= paths.size())
+    {
+        size_t end = paths.find(separator, start);
+        if (end == std::string::npos) end = paths.size();
+        const std::string directory = paths.substr(start, end - start);
+        start = end + 1;
+        if (directory.empty() || directory == "<empty>") continue;
+
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(directory, error), last; !error && it != last; it.increment(error))
+        {
+            const std::filesystem::path& path = it->path();
+            const std::string extension = path.extension().string();
+            const int type = extension == ".rtbw" ? SyzygyTable::WDL : (extension == ".rtbz" ? SyzygyTable::DTZ : -1);
+            int counts[2][7];
+            if (type < 0 || !SyzygyTable::parseName(path.stem().string(), counts)) continue;
+
+            // The same material in two directories is taken from the first
+            const uint64_t key = SyzygyTable::getMaterialKey(counts);
+            Material* material = materialsByKey.count(key) ? materialsByKey[key] : nullptr;
+            if (material == nullptr)
+            {
+                materials.push_back(std::unique_ptr<Material>(new Material()));
+                material = materials.back().get();
+            }
+
+            Slot& slot = type == SyzygyTable::WDL ? material->wdl : material->dtz;
+            if (slot.table) continue;
+            slot.table.reset(new SyzygyTable(type, path.string(), counts));
+            materialsByKey[slot.table->getKey()] = material;
+            materialsByKey[slot.table->getMirroredKey()] = material;
+
+            ++tableCount;
+            if (type == SyzygyTable::WDL) maxPieces = std::max(maxPieces, slot.table->getPieceCount());
+        }
+    }
+
+    return tableCount;
+}
+
+int Tablebases::getTableCount() const
+{
+    return tableCount;
+}
+
+int Tablebases::getMaxPieces() const
+{
+    return maxPieces;
+}
+
+void Tablebases::setMaxMapped(int count)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    maxMapped = (size_t)std::max(1, count);
+}
+
+bool Tablebases::canProbe(const Engine& position) const
+{
+    if (countPieces(position) > maxPieces) return false;
+
+    for (int color = Engine::WHITE; color <= (int)Engine::BLACK; ++color)
+    {
+        if (position.canCastle(color, true) || position.canCastle(color, false)) return false;
+    }
+    return true;
+}
+
+int Tablebases::countPieces(const Engine& position)
+{
+    int count = 0;
+    for (const Bitboard& pieces : position.getPiecePositions()) count += pieces.popCount();
+    return count;
+}
+
+SyzygyTable* Tablebases::acquire(Slot& slot)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!slot.table || slot.broken) return nullptr;
+
+    if (!slot.table->isMapped())
+    {
+        // Make room by unmapping the least recently used table that nothing is reading
+        while (mappedSlots.size() >= maxMapped)
+        {
+            auto oldest = mappedSlots.end();
+            for (auto it = mappedSlots.begin(); it != mappedSlots.end(); ++it)
+            {
+                if ((*it)->users == 0 && (oldest == mappedSlots.end() || (*it)->lastUsed < (*oldest)->lastUsed)) oldest = it;
+            }
+            if (oldest == mappedSlots.end()) break;
+
+            (*oldest)->table->unmap();
+            mappedSlots.erase(oldest);
+        }
+
+        if (!slot.table->map())
+        {
+            slot.broken = true;
+            return nullptr;
+        }
+        mappedSlots.push_back(&slot);
+    }
+
+    ++slot.users;
+    slot.lastUsed = ++useCounter;
+    return slot.table.get();
+}
+
+void Tablebases::release(Slot& slot)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    --slot.users;
+}
+
+int Tablebases::probeTable(Engine& position, int type, int wdl, int& state)
+{
+    if (countPieces(position) == 2) return DRAW; // Kings only
+
+    const auto found = materialsByKey.find(SyzygyTable::getMaterialKey(position));
+    Slot* slot = nullptr;
+    if (found != materialsByKey.end()) slot = type == SyzygyTable::WDL ? &found->second->wdl : &found->second->dtz;
+
+    SyzygyTable* table = slot ? acquire(*slot) : nullptr;
+    if (table == nullptr)
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+
+    bool changeSide;
+    const int value = table->probe(position, wdl, changeSide);
+    release(*slot);
+
+    if (changeSide) state = PROBE_CHANGE_SIDE;
+    return value;
+}
+
+int Tablebases::searchZeroing(Engine& position, bool pawnMoves, int& state)
+{
+    // The generator stores whatever compresses best where a capture wins, and where a capture draws the stored
+    // result may be a loss. So the captures are searched, and the table only decides if it does better than them.
+    // The DTZ probe searches pawn moves too, as DTZ tables leave out positions where one wins.
+    std::vector<Move> moves;
+    position.getLegalMoves(moves);
+
+    int bestValue = LOSS;
+    size_t searched = 0;
+    for (const Move& move : moves)
+    {
+        const bool pawnMove = (move.originPiece - 1) % 6 + 1 == (int)Engine::PAWN;
+        if (!Engine::isCapture(move) && !(pawnMoves && pawnMove)) continue;
+        ++searched;
+
+        position.makePseudoLegalMove(move);
+        const int value = -searchZeroing(position, false, state);
+        position.undoMove(move);
+
+        if (state == PROBE_FAIL) return DRAW;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            if (value >= WIN)
+            {
+                state = PROBE_ZEROING_BEST;
+                return value;
+            }
+        }
+    }
+
+    // With every move searched the table is not needed, and could be wrong: it ignores en passant
+    const bool allSearched = searched != 0 && searched == moves.size();
+    int value = bestValue;
+    if (!allSearched)
+    {
+        value = probeTable(position, SyzygyTable::WDL, DRAW, state);
+        if (state == PROBE_FAIL) return DRAW;
+    }
+
+    if (bestValue >= value)
+    {
+        state = bestValue > DRAW || allSearched ? PROBE_ZEROING_BEST : PROBE_OK;
+        return bestValue;
+    }
+
+    state = PROBE_OK;
+    return value;
+}
+
+int Tablebases::getWdl(Engine& position, int& state)
+{
+    state = PROBE_OK;
+    return searchZeroing(position, false, state);
+}
+
+int Tablebases::dtzBeforeZeroing(int wdl)
+{
+    switch (wdl)
+    {
+    case WIN: return 1;
+    case CURSED_WIN: return 101;
+    case BLESSED_LOSS: return -101;
+    case LOSS: return -1;
+    default: return 0;
+    }
+}
+
+int Tablebases::getDtz(Engine& position, int& state)
+{
+    state = PROBE_OK;
+    const int wdl = searchZeroing(position, true, state);
+    if (state == PROBE_FAIL || wdl == DRAW) return 0; // Draws are not stored
+
+    // The table has nothing useful where a zeroing move is best
+    if (state == PROBE_ZEROING_BEST) return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(position, SyzygyTable::DTZ, wdl, state);
+    if (state == PROBE_FAIL) return 0;
+
+    const int sign = getSign(wdl);
+    if (state != PROBE_CHANGE_SIDE)
+    {
+        return (dtz + (wdl == CURSED_WIN || wdl == BLESSED_LOSS ? 100 : 0)) * sign;
+    }
+
+    // The table holds the other side to move, so take the best move by the DTZ of the positions after it
+    std::vector<Move> moves;
+    position.getLegalMoves(moves);
+
+    int minDtz = 0xFFFF;
+    std::vector<Move> replies;
+    for (const Move& move : moves)
+    {
+        const bool zeroing = Engine::isCapture(move) || (move.originPiece - 1) % 6 + 1 == (int)Engine::PAWN;
+
+        // After a zeroing move the DTZ is that of the move itself, with the sign of the result it leads to
+        position.makePseudoLegalMove(move);
+        dtz = zeroing ? -dtzBeforeZeroing(searchZeroing(position, false, state)) : -getDtz(position, state);
+
+        // A mate is always 1
+        if (dtz == 1 && position.isInCheck(position.getTurn()))
+        {
+            position.getLegalMoves(replies);
+            if (replies.empty()) minDtz = 1;
+        }
+
+        if (!zeroing) dtz += getSign(dtz);
+        if (dtz < minDtz && getSign(dtz) == sign) minDtz = dtz;
+
+        position.undoMove(move);
+        if (state == PROBE_FAIL) return 0;
+    }
+
+    // No legal moves means mate
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+bool Tablebases::probeWdl(Engine& position, int& wdl)
+{
+    if (maxPieces == 0 || !canProbe(position)) return false;
+
+    int state;
+    wdl = getWdl(position, state);
+    return state != PROBE_FAIL;
+}
+
+bool Tablebases::probeDtz(Engine& position, int& dtz)
+{
+    if (maxPieces == 0 || !canProbe(position)) return false;
+
+    int state;
+    dtz = getDtz(position, state);
+    return state != PROBE_FAIL;
+}
+
+bool Tablebases::rankByDtz(Engine& position, const std::vector<Move>& moves, std::vector<int>& ranks)
+{
+    const int halfmoveClock = position.getHalfmoveClock();
+    // Only a repetition of the root itself is seen, not one earlier since the last zeroing move
+    const bool repeated = position.isRepetition();
+
+    std::vector<Move> replies;
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        int state;
+        int dtz;
+        position.makePseudoLegalMove(moves[i]);
+
+        // DTZ counted from the root
+        if (position.getHalfmoveClock() == 0)
+        {
+            dtz = dtzBeforeZeroing(-getWdl(position, state));
+        }
+        else if (isDrawnByRule(position))
+        {
+            state = PROBE_OK;
+            dtz = 0;
+        }
+        else
+        {
+            dtz = -getDtz(position, state);
+            dtz += getSign(dtz);
+        }
+
+        if (dtz == 2 && position.isInCheck(position.getTurn()))
+        {
+            position.getLegalMoves(replies);
+            if (replies.empty()) dtz = 1;
+        }
+
+        position.undoMove(moves[i]);
+        if (state == PROBE_FAIL) return false;
+
+        ranks[i] = dtz > 0 ? (dtz + halfmoveClock <= 99 && !repeated ? MAX_DTZ : MAX_DTZ - (dtz + halfmoveClock))
+            : dtz < 0 ? (-dtz * 2 + halfmoveClock < 100 ? -MAX_DTZ : -MAX_DTZ + (-dtz + halfmoveClock))
+            : 0;
+    }
+    return true;
+}
+
+bool Tablebases::rankByWdl(Engine& position, const std::vector<Move>& moves, std::vector<int>& ranks, bool& ruleDraws)
+{
+    static const int wdlRanks[5] = { -MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ };
+
+    ruleDraws = false;
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        int state = PROBE_OK;
+        position.makePseudoLegalMove(moves[i]);
+        const bool drawn = isDrawnByRule(position);
+        const int wdl = drawn ? DRAW : -getWdl(position, state);
+        position.undoMove(moves[i]);
+        ruleDraws = ruleDraws || drawn;
+        if (state == PROBE_FAIL) return false;
+
+        ranks[i] = wdlRanks[wdl + 2];
+    }
+    return true;
+}
+
+bool Tablebases::filterRootMoves(Engine& position, std::vector<Move>& moves, bool& usedDtz)
+{
+    usedDtz = false;
+    if (moves.empty() || maxPieces == 0 || !canProbe(position)) return false;
+
+    std::vector<int> wdlRanks(moves.size());
+    bool ruleDraws;
+    if (!rankByWdl(position, moves, wdlRanks, ruleDraws)) return false;
+
+    // A misread table must not throw away the moves that win, so the results are checked against each other first.
+    // The root must do as well as its best move, and no better unless a move it counts on repeats or reaches the
+    // fifty move limit. The DTZ of every move must agree with its WDL.
+    int state;
+    const int rootSign = getSign(getWdl(position, state));
+    const int bestSign = getSign(*std::max_element(wdlRanks.begin(), wdlRanks.end()));
+    if (state == PROBE_FAIL || bestSign > rootSign || (bestSign < rootSign && !ruleDraws)) return false;
+
+    std::vector<int> ranks(moves.size());
+    usedDtz = rankByDtz(position, moves, ranks);
+    for (size_t i = 0; usedDtz && i != moves.size(); ++i)
+    {
+        if (getSign(ranks[i]) != getSign(wdlRanks[i])) usedDtz = false;
+    }
+    if (!usedDtz) ranks = wdlRanks;
+
+    const int bestRank = *std::max_element(ranks.begin(), ranks.end());
+    size_t kept = 0;
+    for (size_t i = 0; i != moves.size(); ++i)
+    {
+        if (ranks[i] == bestRank) moves[kept++] = moves[i];
+    }
+    moves.resize(kept);
+    return true;
+}
+
+bool Tablebases::isDrawnByRule(Engine& position)
+{
+    if (position.getHalfmoveClock() == 0) return false;
+    if (position.isRepetition()) return true;
+    if (position.getHalfmoveClock() < 100) return false;
+
+    // The fifty move rule does not undo a mate
+    std::vector<Move> replies;
+    position.getLegalMoves(replies);
+    return !replies.empty() || !position.isInCheck(position.getTurn());
+}
+
+int Tablebases::getSign(int value)
+{
+    return value > 0 ? 1 : (value < 0 ? -1 : 0);
+}
@@ -0,0 +1,81 @@
+#include "TimeManager.h"
+#include <algorithm>
+
+TimeManager::TimeManager() : enabled(false), fixedTime(false), softLimit(0), hardLimit(0), lastScore(0), instability(0.0)
+{
+}
+
+void TimeManager::start(int64_t time, int64_t increment, int movesToGo, int64_t moveTime)
+{
+    enabled = true;
+    lastBestMove = Move();
+    lastScore = 0;
+    instability = 0.0;
+
+    if (moveTime > 0)
+    {
+        fixedTime = true;
+        softLimit = hardLimit = std::max<int64_t>(1, moveTime - MOVE_OVERHEAD);
+        return;
+    }
+
+    fixedTime = false;
+    const int64_t usable = std::max<int64_t>(1, time - MOVE_OVERHEAD);
+    const int moves = movesToGo > 0 ? std::min(movesToGo, DEFAULT_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+    // Share the remaining time out over the moves left, counting on most of the increment coming back.
+    // The hard limit allows a few times that on a difficult move, but never most of the clock.
+    softLimit = usable / moves + increment * 3 / 4;
+    hardLimit = moves == 1 ? usable : std::min(softLimit * 5, usable * 3 / 10 + increment);
+    softLimit = std::max<int64_t>(1, std::min(softLimit, usable));
+    hardLimit = std::max(softLimit, std::min(hardLimit, usable));
+}
+
+void TimeManager::disable()
+{
+    enabled = false;
+}
+
+bool TimeManager::isEnabled() const
+{
+    return enabled;
+}
+
+int64_t TimeManager::getSoftLimit() const
+{
+    return softLimit;
+}
+
+int64_t TimeManager::getHardLimit() const
+{
+    return hardLimit;
+}
+
+bool TimeManager::shouldStop(int depth, const Move& bestMove, int score, double bestMoveEffort, int64_t elapsedMs)
+{
+    if (!enabled) return false;
+    if (fixedTime) return elapsedMs >= hardLimit;
+
+    // A best move that keeps changing needs more time to settle
+    instability *= 0.5;
+    if (depth > 1 && bestMove != lastBestMove) instability += 1.0;
+    double scale = 1.0 + instability * 0.5;
+
+    // So does a falling score, up to 60% more for a large drop
+    if (depth > 1 && score < lastScore) scale *= 1.0 + std::min(lastScore - score, 120) / 200.0;
+
+    // One move taking nearly all the effort is unlikely to be overturned
+    if (depth >= 6 && bestMoveEffort > 0.9) scale *= 0.5;
+
+    lastBestMove = bestMove;
+    lastScore = score;
+
+    // The next iteration usually takes longer than all previous ones together, so only start it with half the time left
+    const double optimum = std::min((double)hardLimit, softLimit * scale);
+    return elapsedMs >= optimum / 2;
+}
+
+bool TimeManager::isHardLimitReached(int64_t elapsedMs) const
+{
+    return enabled && elapsedMs >= hardLimit;
+}
@@ -0,0 +1,145 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable(size_t megabytes) : bucketCount(0), generation(0)
+{
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    // Round down to a power of two so the index is a mask of the key
+    const size_t maxBuckets = (megabytes * 1024 * 1024) / sizeof(Bucket);
+    size_t count = 1;
+    while (count * 2 <= maxBuckets) count *= 2;
+
+    // Over-aligned, so this goes through the aligned operator new
+    buckets.reset(new Bucket[count]);
+    bucketCount = count;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i != bucketCount; ++i)
+    for (Entry& entry : buckets[i].entries)
+    {
+        entry.key.store(0, std::memory_order_relaxed);
+        entry.data.store(0, std::memory_order_relaxed);
+    }
+    generation = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+    ++generation;
+}
+
+TranspositionTable::Bucket& TranspositionTable::getBucket(uint64_t key) const
+{
+    return buckets[key & (bucketCount - 1)];
+}
+
+bool TranspositionTable::probe(uint64_t key, Data& data) const
+{
+    const Bucket& bucket = getBucket(key);
+    for (const Entry& entry : bucket.entries)
+    {
+        const uint64_t entryData = entry.data.load(std::memory_order_relaxed);
+        const uint64_t entryKey = entry.key.load(std::memory_order_relaxed);
+        if ((entryKey ^ entryData) == key && entryData != 0)
+        {
+            unpack(entryData, data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, int bound, const Move& move)
+{
+    Bucket& bucket = getBucket(key);
+
+    // Prefer the slot holding this position, otherwise replace the shallowest and oldest entry
+    Entry* replace = &bucket.entries[0];
+    Move storedMove = move;
+    int replaceWorth = 1 << 30;
+    for (Entry& entry : bucket.entries)
+    {
+        const uint64_t entryData = entry.data.load(std::memory_order_relaxed);
+        const uint64_t entryKey = entry.key.load(std::memory_order_relaxed);
+
+        if (entryData == 0)
+        {
+            replace = &entry;
+            break;
+        }
+
+        if ((entryKey ^ entryData) == key)
+        {
+            // Keep the old move if the new result has none
+            if (move.originIndex == move.targetIndex)
+            {
+                Data old;
+                unpack(entryData, old);
+                storedMove = old.move;
+            }
+            replace = &entry;
+            break;
+        }
+
+        const int age = (uint8_t)(generation - getGeneration(entryData));
+        const int worth = getDepth(entryData) - 8 * age;
+        if (worth < replaceWorth)
+        {
+            replaceWorth = worth;
+            replace = &entry;
+        }
+    }
+
+    const uint64_t data = pack(depth, score, bound, storedMove, generation);
+    replace->key.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    int used = 0;
+    const size_t sampled = bucketCount < 250 ? bucketCount : 250;
+    for (size_t i = 0; i != sampled; ++i)
+    for (const Entry& entry : buckets[i].entries)
+    {
+        const uint64_t entryData = entry.data.load(std::memory_order_relaxed);
+        if (entryData != 0 && getGeneration(entryData) == generation) ++used;
+    }
+    return (int)(used * 1000 / (sampled * BUCKET_SIZE));
+}
+
+uint64_t TranspositionTable::pack(int depth, int score, int bound, const Move& move, uint8_t generation)
+{
+    if (depth < 0) depth = 0;
+    if (depth > 255) depth = 255;
+
+    return (uint64_t)move.pack()
+        | ((uint64_t)(uint16_t)(int16_t)score << 16)
+        | ((uint64_t)depth << 32)
+        | ((uint64_t)bound << 40)
+        | ((uint64_t)generation << 42);
+}
+
+void TranspositionTable::unpack(uint64_t data, Data& out)
+{
+    out.move = Move::unpack((uint16_t)data);
+    out.score = (int16_t)(uint16_t)(data >> 16);
+    out.depth = getDepth(data);
+    out.bound = (int)((data >> 40) & 3);
+}
+
+int TranspositionTable::getDepth(uint64_t data)
+{
+    return (int)((data >> 32) & 255);
+}
+
+uint8_t TranspositionTable::getGeneration(uint64_t data)
+{
+    return (uint8_t)(data >> 42);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <atomic>
+#include <BoundedQueue.h>
+#include <BufferedWriter.h>
+#include <Search.h>
+
+/*
+* Responsible for analysing a file of FEN or EPD positions on a pool of workers.
+* The input is mapped rather than read and positions are handed out as views into it.
+* Every worker has its own engine and search, and each result goes out as one line of JSON
+* through a single writer thread, e.g.
+* {"line":1,"id":"WAC.001","fen":"...","bestmove":"g3g6","score":{"cp":310},"depth":10,"nodes":81234,"time_ms":42,"pv":["g3g6","f7g6"]}
+*/
+class BatchAnalyzer
+{
+public:
+	struct Settings
+	{
+		Settings() : threads(1), hashSize(16), depth(0), nodes(0), moveTime(0) {}
+		int threads; // Workers, each searching a position on one thread
+		size_t hashSize; // Megabytes per worker
+
+		// Limits for every position, 0 for none. An EPD line can set its own with acd, acn and acs.
+		int depth;
+		uint64_t nodes;
+		int64_t moveTime;
+	};
+
+	explicit BatchAnalyzer(const Settings& settings);
+
+	// Returns false if the input cannot be read or the output cannot be written. Progress goes to log.
+	bool run(const std::string& inputPath, const std::string& outputPath, std::ostream& log);
+
+	// Search depth used when no limit is given at all
+	static const int DEFAULT_DEPTH = 8;
+
+private:
+	static const int QUEUE_SLOTS_PER_WORKER = 4;
+
+	struct Job
+	{
+		uint64_t lineNumber;
+		std::string_view line;
+	};
+
+	Settings settings;
+	BufferedWriter writer;
+
+	std::atomic<uint64_t> positionsDone;
+	std::atomic<uint64_t> errors;
+	std::atomic<uint64_t> totalNodes;
+
+	void work(BoundedQueue<Job>& jobs);
+	void analyse(const Job& job, Engine& engine, Search& search, std::string& out);
+	Search::Limits getLimits(std::string_view operations) const;
+
+	static void appendString(std::string& out, std::string_view text);
+	static void appendScore(std::string& out, int score);
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <mutex>
+#include <functional>
+
+/*
+* Responsible for building a Polyglot opening book out of PGN games.
+* Every move played in the first plies of a finished game is counted with the score it got, in a hash map split
+* into shards so the replaying threads rarely wait on each other. The shards have a fixed size: once one fills up
+* it is sorted and spilled to a run file on disk, and at the end the runs are merged into the book.
+* Only so many runs are merged at once, in passes that write bigger runs until few enough are left for the book.
+* Memory use and open files are therefore set by the settings rather than by the number of games.
+*/
+class BookBuilder
+{
+public:
+	struct Settings
+	{
+		Settings() : threads(1), maxPly(20), minCount(3), minScore(0), memory(256) {}
+		int threads;
+		int maxPly; // Moves after this many plies are not counted
+		int minCount; // Times a move must have been played to be kept
+		int minScore; // Percentage the side playing a move must have scored with it to be kept
+		size_t memory; // Megabytes for the counts, split over the shards
+	};
+
+	explicit BookBuilder(const Settings& settings);
+
+	// Returns false if the games cannot be read or the book or a run file cannot be written. Progress goes to log.
+	bool run(const std::vector<std::string>& inputPaths, const std::string& outputPath, std::ostream& log);
+
+private:
+	static const int SHARDS = 64;
+	static const size_t MIN_SLOTS = 1024;
+	static const size_t MAX_MERGE_RUNS = 32; // Runs open at once, well under the stream limit of the C runtime
+	static const size_t MIN_RUN_BUFFER_SIZE = 1 << 12;
+	static const size_t RUN_BUFFER_SIZE = 1 << 16; // Per run while merging, less if the memory setting is small
+	static const size_t WRITE_CHUNK_SIZE = 1 << 20;
+
+	// A position and move with its games and score in half points, from the point of view of the side playing it.
+	// Run files are arrays of these sorted by key and move.
+	struct Record
+	{
+		Record() : key(0), move(0), count(0), points(0) {}
+		Record(uint64_t key, uint16_t move, uint32_t count, uint32_t points) : key(key), move(move), count(count), points(points) {}
+		uint64_t key;
+		uint16_t move;
+		uint32_t count;
+		uint32_t points;
+	};
+
+	// Open addressing, so the memory is allocated once. An empty slot has a count of 0.
+	struct Shard
+	{
+		std::mutex mutex;
+		std::vector<Record> slots;
+		size_t used;
+	};
+
+	Settings settings;
+	std::vector<Shard> shards;
+	size_t maxUsed; // Per shard, above which it is spilled
+
+	std::string runPrefix;
+	std::mutex runMutex;
+	std::vector<std::string> runPaths;
+	bool runError;
+
+	void add(uint64_t key, uint16_t move, uint32_t points);
+
+	// Must be called with the shards locked. Writes the shards from first up to last as one run, which is sorted
+	// as each shard holds a range of keys, and leaves them empty.
+	bool spill(size_t first, size_t last);
+
+	// Merges the runs into the book and removes them. Returns the number of entries written, or -1 on error.
+	int64_t merge(const std::string& outputPath, std::ostream& log);
+
+	// Merges some runs, adding up the records of the same move, hands each record over in order and removes the runs.
+	// Returns false if a run cannot be read or the callback returns false.
+	bool mergeRuns(const std::vector<std::string>& paths, size_t bufferSize, const std::function<bool(const Record&)>& callback, std::ostream& log);
+
+	// Appends the moves of one position that pass the filters as Polyglot entries. Returns how many there were.
+	int appendPosition(std::vector<Record>& moves, std::string& out) const;
+
+	static bool isBefore(const Record& lhs, const Record& rhs);
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+/*
+* Responsible for passing work between any number of producer and consumer threads.
+* push() blocks while the queue is full, so a fast producer is held back by slow consumers
+* instead of buffering the whole input in memory.
+*/
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// Blocks while the queue is full. Returns false if the queue was closed.
+	bool push(T item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this]() { return items.size() < capacity || closed; });
+		if (closed) return false;
+
+		items.push_back(std::move(item));
+		lock.unlock();
+		notEmpty.notify_one();
+		return true;
+	}
+
+	// Blocks while the queue is empty. Returns false once the queue is closed and drained.
+	bool pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this]() { return !items.empty() || closed; });
+		if (items.empty()) return false;
+
+		item = std::move(items.front());
+		items.pop_front();
+		lock.unlock();
+		notFull.notify_one();
+		return true;
+	}
+
+	// No more items will be pushed. Consumers still get what is queued.
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+
+private:
+	const size_t capacity;
+	std::deque<T> items;
+	bool closed;
+
+	std::mutex mutex;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+};
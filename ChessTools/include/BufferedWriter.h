@@ -0,0 +1,47 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <BoundedQueue.h>
+
+/*
+* Responsible for writing output on its own thread.
+* Producers hand over finished chunks, which are gathered into large blocks before they reach the file,
+* so many threads can report results without taking turns on the file or waiting for the disk.
+*/
+class BufferedWriter
+{
+public:
+	BufferedWriter();
+	~BufferedWriter();
+
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	// "-" writes to standard output. Returns false if the file cannot be created.
+	bool open(const std::string& path);
+
+	// Queues bytes to be written. Blocks while the writer is too far behind.
+	void write(std::string chunk);
+
+	// Writes everything queued and closes the file. Returns false if any write failed.
+	bool close();
+
+	uint64_t getBytesWritten() const;
+
+private:
+	static const size_t QUEUE_CAPACITY = 1024;
+	static const size_t BLOCK_SIZE = 1 << 20;
+
+	BoundedQueue<std::string> queue;
+	std::thread thread;
+	FILE* file;
+	bool ownsFile;
+	std::atomic<bool> failed;
+	std::atomic<uint64_t> bytesWritten;
+
+	void run();
+	void flush(std::string& block);
+};
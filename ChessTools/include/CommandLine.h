@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/*
+* Responsible for reading the arguments of a tool, e.g. "input.epd --depth 10 --threads 8".
+* Arguments starting with "--" are options that take the next argument as their value,
+* or none if the next one is another option. Everything else is positional.
+*/
+class CommandLine
+{
+public:
+	CommandLine(int argc, char* argv[], int first);
+
+	const std::vector<std::string>& getPositional() const;
+
+	bool has(const std::string& name);
+	std::string getString(const std::string& name, const std::string& fallback);
+	int64_t getInt(const std::string& name, int64_t fallback);
+	double getDouble(const std::string& name, double fallback);
+
+	// Empty if every option was asked for and every number could be read.
+	// Checked after reading the options, so misspelt options are not silently ignored.
+	std::string getError() const;
+
+private:
+	std::vector<std::string> positional;
+	std::map<std::string, std::string> options;
+	std::map<std::string, bool> used;
+	std::string error;
+};
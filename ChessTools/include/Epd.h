@@ -0,0 +1,24 @@
+#pragma once
+#include <string_view>
+
+/*
+* Responsible for reading lines of FEN and EPD text in place.
+* An EPD line is the first four FEN fields followed by operations such as: bm Nf3; id "WAC.001";
+*/
+class Epd
+{
+public:
+	// Takes the next line off the front of text, without its line ending. Returns false at the end of the text.
+	static bool nextLine(std::string_view& text, std::string_view& line);
+
+	// Splits a line into the position and the operations after it. The position keeps the move counters
+	// if the line has them, so plain FEN lines work too. Returns false for blank lines and # comments.
+	static bool split(std::string_view line, std::string_view& fen, std::string_view& operations);
+
+	// Operands of an operation with the quotes removed, e.g. "Nf3 e4" for "bm Nf3 e4;". Empty if it is not there.
+	static std::string_view getOperation(std::string_view operations, std::string_view opcode);
+
+private:
+	static std::string_view trim(std::string_view text);
+	static bool isNumber(std::string_view text);
+};
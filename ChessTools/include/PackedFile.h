@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <MappedFile.h>
+#include <PackedPosition.h>
+
+/*
+* Responsible for reading a file of PackedPosition records in place.
+* The file is mapped, so any record can be read without reading the ones before it.
+*/
+class PackedFile
+{
+public:
+	PackedFile();
+
+	// Returns false if the file cannot be mapped or is not a whole number of records
+	bool open(const std::string& path);
+
+	size_t getCount() const;
+	const PackedPosition& operator[](size_t index) const;
+
+private:
+	MappedFile file;
+	const PackedPosition* records;
+	size_t count;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <PackedPosition.h>
+#include <BufferedWriter.h>
+
+/*
+* Responsible for writing PackedPosition records from any number of threads.
+* Writes go through a BufferedWriter, so callers should hand over records in batches rather than one at a time.
+*/
+class PackedWriter
+{
+public:
+	PackedWriter();
+
+	bool open(const std::string& path);
+
+	void write(const PackedPosition* records, size_t recordCount);
+
+	// Returns false if any write failed
+	bool close();
+
+	uint64_t getCount() const;
+
+private:
+	BufferedWriter writer;
+	std::atomic<uint64_t> count;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+/*
+* Responsible for reading games out of PGN text in place, without copying them.
+* Games are views into the text, which is normally a mapped file, so the text has to outlive them.
+*/
+class PgnReader
+{
+public:
+	struct Game
+	{
+		std::string_view tags; // The [Name "Value"] lines
+		std::string_view moves; // Movetext with numbers, comments, variations and the result
+
+		// Value of a tag without the quotes, empty if the game does not have it
+		std::string_view getTag(std::string_view name) const;
+	};
+
+	explicit PgnReader(std::string_view text);
+
+	// Returns false once there are no more games
+	bool nextGame(Game& game);
+
+	// Takes the next move off the front of the movetext, skipping move numbers, comments,
+	// variations, annotation glyphs and the result. Returns false at the end of the game.
+	static bool nextMove(std::string_view& moves, std::string_view& san);
+
+	// Splits the text into at most count parts of about the same size, each starting at a game,
+	// so that the parts can be read on different threads
+	static std::vector<std::string_view> split(std::string_view text, int count);
+
+private:
+	std::string_view text;
+
+	static bool isSpace(char c);
+};
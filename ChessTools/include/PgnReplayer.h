@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <atomic>
+#include <PgnReader.h>
+
+class Engine;
+struct Move;
+
+/*
+* Responsible for playing through every game of a PGN file, spread over threads.
+* The file is mapped and split on game boundaries, one part per thread, and each thread plays
+* its games on its own engine. Moves are found with Engine::parseSan and played without generating
+* the legal moves, so the speed is mostly that of reading the text.
+*/
+class PgnReplayer
+{
+public:
+	// Called for every move in the position it is played from, before it is played, with the number of plies before it.
+	// The part is the index of the thread, so callers can keep per-thread state without locking.
+	// Returning false skips the rest of the game.
+	typedef std::function<bool(int part, Engine& position, const Move& move, int ply, const PgnReader::Game& game)> MoveCallback;
+
+	explicit PgnReplayer(int threads);
+
+	void setMoveCallback(MoveCallback callback);
+
+	// Returns false if the file cannot be read. Progress and throughput go to log.
+	bool run(const std::string& path, std::ostream& log);
+
+	int getThreads() const;
+
+private:
+	static const int MAX_REPORTED_ERRORS = 10;
+
+	int threads;
+	MoveCallback moveCallback;
+
+	std::atomic<uint64_t> games;
+	std::atomic<uint64_t> moves;
+	std::atomic<uint64_t> errors;
+
+	// First few errors of each part, reported after the run
+	std::vector<std::vector<std::string>> errorMessages;
+
+	void replayPart(int part, std::string_view text, const char* fileStart);
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <PackedPosition.h>
+
+class PackedWriter;
+
+/*
+* Responsible for converting positions between text and the packed binary format.
+* FEN and EPD lines keep their best move (bm), evaluation (ce), halfmove clock (hmvc) and result, e.g. result "1-0";
+* PGN games give every position before a move, with the move played as best move and the game result.
+*/
+class PositionPacker
+{
+public:
+	static bool packText(const std::string& inputPath, PackedWriter& output, std::ostream& log);
+	static bool packPgn(const std::string& inputPath, PackedWriter& output, int threads, std::ostream& log);
+
+	// Writes records as EPD lines, from the start index on and at most count of them
+	static bool unpack(const std::string& inputPath, const std::string& outputPath, uint64_t start, uint64_t count, std::ostream& log);
+
+private:
+	static const size_t BATCH_SIZE = 4096;
+
+	static uint8_t parseResult(std::string_view result);
+	static const char* resultToString(uint8_t result);
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <PackedPosition.h>
+#include <PackedWriter.h>
+#include <Move.h>
+
+class Engine;
+class Search;
+
+/*
+* Responsible for generating training positions by having the engine play itself.
+* Every thread plays whole games on its own engine and search at a fixed node count or depth.
+* Games start from the starting position or a random line of an opening file, followed by a few random moves,
+* and are adjudicated once the score stays decisive or level for long enough.
+* Positions are labelled with the search score and, once the game is over, its result, and go out through one PackedWriter.
+*/
+class SelfPlay
+{
+public:
+	struct Settings
+	{
+		Settings() : threads(1), hashSize(8), games(1000), depth(0), nodes(0), randomPlies(8), seed(0),
+			resignScore(1000), resignPlies(6), drawScore(10), drawPlies(12), drawMinPly(60), maxPlies(400) {}
+		int threads; // Games played at once, each on one thread
+		size_t hashSize; // Megabytes per thread
+		uint64_t games;
+
+		// Search limits for every move, 0 for none
+		int depth;
+		uint64_t nodes;
+
+		// Random moves played after the opening, so games do not repeat
+		int randomPlies;
+		uint64_t seed;
+
+		// A side resigns once the score has been at least resignScore against it for resignPlies plies in a row.
+		// A game is drawn once the score has been within drawScore for drawPlies plies after drawMinPly,
+		// or once it reaches maxPlies.
+		int resignScore;
+		int resignPlies;
+		int drawScore;
+		int drawPlies;
+		int drawMinPly;
+		int maxPlies;
+	};
+
+	explicit SelfPlay(const Settings& settings);
+
+	// FEN or EPD lines to start games from. Returns false if the file cannot be read or has no valid position.
+	bool loadOpenings(const std::string& path, std::ostream& log);
+
+	// Returns false if the output cannot be written. Progress goes to log.
+	bool run(const std::string& outputPath, std::ostream& log);
+
+	// Node count used when no limit is given at all
+	static const uint64_t DEFAULT_NODES = 5000;
+
+private:
+	static const size_t BATCH_SIZE = 4096;
+
+	Settings settings;
+	PackedWriter writer;
+	std::vector<std::string> openings;
+
+	std::atomic<uint64_t> gamesStarted;
+	std::atomic<uint64_t> gamesDone;
+	std::atomic<uint64_t> positionsDone; // Counted when a game ends, while the writer only counts them once a batch is written
+	std::atomic<uint64_t> totalNodes;
+	std::atomic<uint64_t> results[4]; // By PackedPosition result
+
+	// Lets the reporting thread sleep until every worker is done
+	std::mutex mutex;
+	std::condition_variable finished;
+	int running;
+
+	void work(int thread);
+
+	// Plays one game and adds its positions to batch. Returns the number of nodes searched.
+	uint64_t playGame(Engine& engine, Search& search, std::mt19937_64& random, std::vector<PackedPosition>& batch);
+	bool startGame(Engine& engine, std::mt19937_64& random);
+
+	// Result if the game is over without a search: mate, stalemate, repetition, the fifty move rule or too little material
+	static uint8_t getGameResult(Engine& engine, std::vector<Move>& moves);
+	static bool isInsufficientMaterial(const Engine& engine);
+};
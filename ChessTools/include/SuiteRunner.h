@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <BoundedQueue.h>
+#include <Search.h>
+
+/*
+* Responsible for running an EPD test suite, e.g. Win At Chess, against the engine on a pool of workers.
+* A position is solved when the engine ends on one of its bm moves, or on none of its am moves.
+* Time and nodes to solution are taken at the iteration that first found the move and kept it to the end.
+* The report lists the positions in file order, so reports of two builds can be diffed.
+*/
+class SuiteRunner
+{
+public:
+	struct Settings
+	{
+		Settings() : threads(1), hashSize(16), depth(0), nodes(0), moveTime(0), stableIterations(0) {}
+		int threads; // Workers, each searching a position on one thread
+		size_t hashSize; // Megabytes per worker
+
+		// Limits for every position, 0 for none
+		int depth;
+		uint64_t nodes;
+		int64_t moveTime;
+
+		// Stop a position early once its best move has not changed for this many iterations, 0 to never
+		int stableIterations;
+
+		// Selective search techniques, so the effect of each on the solve rate can be measured
+		Search::Options searchOptions;
+	};
+
+	explicit SuiteRunner(const Settings& settings);
+
+	// Returns false if the suite cannot be read. The report goes to out, progress to log.
+	bool run(const std::string& suitePath, std::ostream& out, std::ostream& log);
+
+	// Time per position used when no limit is given at all
+	static const int DEFAULT_MOVE_TIME = 1000;
+
+private:
+	static const int QUEUE_SLOTS_PER_WORKER = 4;
+
+	struct Job
+	{
+		size_t index; // Into outcomes
+		std::string_view fen;
+		std::string_view operations;
+	};
+
+	struct Outcome
+	{
+		Outcome() : lineNumber(0), solved(false), depth(0), timeMs(0), nodes(0), solvedDepth(0), solvedTimeMs(0), solvedNodes(0) {}
+		uint64_t lineNumber;
+		std::string id;
+		std::string expected; // The bm or am operation
+		std::string error; // Empty unless the position could not be run
+		std::string bestMove; // In SAN, like the bm and am moves
+		bool solved;
+		int depth;
+		int64_t timeMs;
+		uint64_t nodes;
+
+		// When the solution was found for good
+		int solvedDepth;
+		int64_t solvedTimeMs;
+		uint64_t solvedNodes;
+	};
+
+	// Follows one search iteration by iteration
+	struct Tracker
+	{
+		std::vector<Move> bestMoves;
+		std::vector<Move> avoidMoves;
+		Move lastBest;
+		int unchangedIterations;
+		Outcome* outcome;
+
+		bool isSolution(const Move& move) const;
+	};
+
+	Settings settings;
+	std::vector<Outcome> outcomes;
+	std::atomic<uint64_t> positionsDone;
+
+	void work(BoundedQueue<Job>& jobs);
+	void runPosition(const Job& job, Engine& engine, Search& search, Tracker& tracker);
+	void onIteration(const Search::Info& info, Search& search, Tracker& tracker);
+
+	// Reads the moves of a bm or am operation. Returns false if one of them is not legal.
+	static bool parseMoves(Engine& engine, std::string_view text, std::vector<Move>& moves, std::string& error);
+
+	void writeReport(std::ostream& out, double seconds) const;
+};
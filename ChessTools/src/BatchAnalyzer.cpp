@@ -0,0 +1,213 @@
+#include "BatchAnalyzer.h"
+#include "Epd.h"
+#include <MappedFile.h>
+#include <Engine.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <iomanip>
+
+BatchAnalyzer::BatchAnalyzer(const Settings& settings) : settings(settings), positionsDone(0), errors(0), totalNodes(0)
+{
+    if (this->settings.threads < 1) this->settings.threads = 1;
+    if (this->settings.depth == 0 && this->settings.nodes == 0 && this->settings.moveTime == 0) this->settings.depth = DEFAULT_DEPTH;
+}
+
+bool BatchAnalyzer::run(const std::string& inputPath, const std::string& outputPath, std::ostream& log)
+{
+    MappedFile input;
+    if (!input.open(inputPath))
+    {
+        log << "Could not read " << inputPath << std::endl;
+        return false;
+    }
+    if (!writer.open(outputPath))
+    {
+        log << "Could not create " << outputPath << std::endl;
+        return false;
+    }
+
+    // Small enough that the reader only stays a few positions ahead of the workers
+    BoundedQueue<Job> jobs(settings.threads * QUEUE_SLOTS_PER_WORKER);
+    std::vector<std::thread> workers;
+    for (int i = 0; i != settings.threads; ++i) workers.emplace_back(&BatchAnalyzer::work, this, std::ref(jobs));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    auto elapsedSeconds = [&start]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    std::string_view text((const char*)input.getData(), input.getSize());
+    std::string_view line;
+    uint64_t lineNumber = 0;
+    while (Epd::nextLine(text, line))
+    {
+        jobs.push({ ++lineNumber, line });
+
+        // Progress every few seconds, from the reader since it wakes up whenever a worker takes a job
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(5))
+        {
+            lastReport = now;
+            const uint64_t done = positionsDone.load(std::memory_order_relaxed);
+            log << done << " positions, " << (uint64_t)(done / elapsedSeconds()) << " positions/sec" << std::endl;
+        }
+    }
+
+    jobs.close();
+    for (std::thread& worker : workers) worker.join();
+    const bool written = writer.close();
+    const double seconds = elapsedSeconds();
+
+    const uint64_t done = positionsDone.load();
+    log << "Analysed " << done << " positions (" << errors.load() << " invalid) in " << std::fixed << std::setprecision(2) << seconds << "s on "
+        << settings.threads << " workers: " << (uint64_t)(done / seconds) << " positions/sec, " << (uint64_t)(totalNodes.load() / seconds) << " nodes/sec" << std::endl;
+
+    if (!written) log << "Could not write all of " << outputPath << std::endl;
+    return written;
+}
+
+void BatchAnalyzer::work(BoundedQueue<Job>& jobs)
+{
+    Engine engine;
+    Search search;
+    search.setHashSize(settings.hashSize);
+
+    std::string out;
+    Job job;
+    while (jobs.pop(job))
+    {
+        out.clear();
+        analyse(job, engine, search, out);
+        if (!out.empty()) writer.write(out);
+    }
+}
+
+void BatchAnalyzer::analyse(const Job& job, Engine& engine, Search& search, std::string& out)
+{
+    std::string_view fen, operations;
+    if (!Epd::split(job.line, fen, operations)) return;
+
+    out += "{\"line\":";
+    out += std::to_string(job.lineNumber);
+
+    const std::string_view id = Epd::getOperation(operations, "id");
+    if (!id.empty())
+    {
+        out += ",\"id\":";
+        appendString(out, id);
+    }
+    out += ",\"fen\":";
+    appendString(out, fen);
+
+    std::string error;
+    if (!engine.loadFen(fen, &error))
+    {
+        out += ",\"error\":";
+        appendString(out, error);
+        out += "}\n";
+        errors.fetch_add(1, std::memory_order_relaxed);
+        positionsDone.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // A fresh table for every position, so results do not depend on which worker got which position before
+    search.clearHash();
+
+    search.prepare();
+    const auto start = std::chrono::steady_clock::now();
+    const Search::Result result = search.go(engine, getLimits(operations));
+    const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // A null move means there was no legal move
+    if (result.bestMove.originPiece == 0) out += ",\"bestmove\":null";
+    else
+    {
+        out += ",\"bestmove\":\"";
+        out += Engine::moveToString(result.bestMove);
+        out += "\",\"score\":";
+        appendScore(out, result.score);
+    }
+
+    out += ",\"depth\":";
+    out += std::to_string(result.depth);
+    out += ",\"nodes\":";
+    out += std::to_string(result.nodes);
+    out += ",\"time_ms\":";
+    out += std::to_string(ms);
+
+    out += ",\"pv\":[";
+    if (!result.lines.empty())
+    {
+        const std::vector<Move>& pv = result.lines[0].pv;
+        for (size_t i = 0; i != pv.size(); ++i)
+        {
+            if (i != 0) out += ',';
+            out += '"';
+            out += Engine::moveToString(pv[i]);
+            out += '"';
+        }
+    }
+    out += "]}\n";
+
+    totalNodes.fetch_add(result.nodes, std::memory_order_relaxed);
+    positionsDone.fetch_add(1, std::memory_order_relaxed);
+}
+
+Search::Limits BatchAnalyzer::getLimits(std::string_view operations) const
+{
+    Search::Limits limits;
+    if (settings.depth > 0) limits.depth = settings.depth;
+    limits.nodes = settings.nodes;
+    limits.moveTime = settings.moveTime;
+
+    // Depth, nodes and seconds from the standard EPD analysis opcodes replace the defaults for that line
+    const std::string_view depth = Epd::getOperation(operations, "acd");
+    const std::string_view nodes = Epd::getOperation(operations, "acn");
+    const std::string_view seconds = Epd::getOperation(operations, "acs");
+    if (!depth.empty()) limits.depth = std::max(1, std::atoi(std::string(depth).c_str()));
+    if (!nodes.empty()) limits.nodes = std::strtoull(std::string(nodes).c_str(), nullptr, 10);
+    if (!seconds.empty()) limits.moveTime = (int64_t)(std::atof(std::string(seconds).c_str()) * 1000);
+    return limits;
+}
+
+void BatchAnalyzer::appendString(std::string& out, std::string_view text)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    out += '"';
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            out += "\\u00";
+            out += hexDigits[(c >> 4) & 15];
+            out += hexDigits[c & 15];
+        }
+        else out += c;
+    }
+    out += '"';
+}
+
+void BatchAnalyzer::appendScore(std::string& out, int score)
+{
+    if (std::abs(score) < Search::MATE_SCORE - Search::MAX_PLY)
+    {
+        out += "{\"cp\":";
+        out += std::to_string(score);
+    }
+    else
+    {
+        // In moves rather than plies, negative when getting mated
+        const int moves = (Search::MATE_SCORE - std::abs(score) + 1) / 2;
+        out += "{\"mate\":";
+        out += std::to_string(score > 0 ? moves : -moves);
+    }
+    out += '}';
+}
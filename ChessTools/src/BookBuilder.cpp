@@ -0,0 +1,306 @@
+#include "BookBuilder.h"
+#include "PgnReplayer.h"
+#include "BufferedWriter.h"
+#include <Engine.h>
+#include <OpeningBook.h>
+#include <algorithm>
+#include <queue>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+
+BookBuilder::BookBuilder(const Settings& settings) : settings(settings), shards(SHARDS), runError(false)
+{
+    if (this->settings.threads < 1) this->settings.threads = 1;
+
+    // The largest power of two that fits, so a slot is found with a mask
+    const size_t budget = std::max<size_t>(this->settings.memory, 1) * 1024 * 1024 / SHARDS / sizeof(Record);
+    size_t slots = MIN_SLOTS;
+    while (slots * 2 <= budget) slots *= 2;
+
+    // Spilled while there is still room, so probes stay short
+    maxUsed = slots / 4 * 3;
+    for (Shard& shard : shards)
+    {
+        shard.slots.assign(slots, Record());
+        shard.used = 0;
+    }
+}
+
+bool BookBuilder::run(const std::vector<std::string>& inputPaths, const std::string& outputPath, std::ostream& log)
+{
+    runPrefix = outputPath + ".run";
+
+    PgnReplayer replayer(settings.threads);
+    replayer.setMoveCallback([this](int, Engine& position, const Move& move, int ply, const PgnReader::Game& game)
+    {
+        if (ply >= settings.maxPly) return false;
+
+        // Only finished games say how good a move was
+        const std::string_view result = game.getTag("Result");
+        uint32_t whitePoints;
+        if (result == "1-0") whitePoints = 2;
+        else if (result == "1/2-1/2") whitePoints = 1;
+        else if (result == "0-1") whitePoints = 0;
+        else return false;
+
+        add(OpeningBook::getKey(position), OpeningBook::encodeMove(move), position.getTurn() == (int)Engine::WHITE ? whitePoints : 2 - whitePoints);
+        return true;
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : inputPaths)
+    {
+        if (!replayer.run(path, log)) return false;
+    }
+
+    // What is left in memory becomes one last run
+    for (Shard& shard : shards) shard.mutex.lock();
+    size_t used = 0;
+    for (const Shard& shard : shards) used += shard.used;
+    if (used != 0) spill(0, shards.size());
+    for (Shard& shard : shards) shard.mutex.unlock();
+    if (runError)
+    {
+        log << "Could not write the run files next to " << outputPath << std::endl;
+        return false;
+    }
+
+    // The merge gets the memory of the tables
+    for (Shard& shard : shards) std::vector<Record>().swap(shard.slots);
+
+    const size_t runCount = runPaths.size();
+    const int64_t entries = merge(outputPath, log);
+    if (entries < 0) return false;
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    log << "Wrote " << entries << " book entries to " << outputPath << " from " << runCount << " runs in "
+        << std::fixed << std::setprecision(2) << seconds << "s" << std::endl;
+    return true;
+}
+
+void BookBuilder::add(uint64_t key, uint16_t move, uint32_t points)
+{
+    // The key is already random, so its top bits pick the shard and its low bits the slot
+    const size_t shardIndex = (size_t)(key >> 58);
+    Shard& shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const size_t mask = shard.slots.size() - 1;
+    size_t index = (key ^ (move * 0x9E3779B97F4A7C15ULL)) & mask;
+    while (shard.slots[index].count != 0)
+    {
+        Record& record = shard.slots[index];
+        if (record.key == key && record.move == move)
+        {
+            ++record.count;
+            record.points += points;
+            return;
+        }
+        index = (index + 1) & mask;
+    }
+
+    // A new move. The table is empty after a spill, so the slot found is still free.
+    if (shard.used >= maxUsed) spill(shardIndex, shardIndex + 1);
+    shard.slots[index] = { key, move, 1, points };
+    ++shard.used;
+}
+
+bool BookBuilder::spill(size_t first, size_t last)
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        path = runPrefix + std::to_string(runPaths.size());
+        runPaths.push_back(path);
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    bool written = file != nullptr;
+    for (size_t i = first; i != last; ++i)
+    {
+        Shard& shard = shards[i];
+
+        // Sorted in place, so spilling needs no memory beyond the table
+        size_t count = 0;
+        for (const Record& record : shard.slots)
+        {
+            if (record.count != 0) shard.slots[count++] = record;
+        }
+        std::sort(shard.slots.begin(), shard.slots.begin() + count, isBefore);
+        if (written && std::fwrite(shard.slots.data(), sizeof(Record), count, file) != count) written = false;
+
+        std::fill(shard.slots.begin(), shard.slots.end(), Record());
+        shard.used = 0;
+    }
+    if (file != nullptr && std::fclose(file) != 0) written = false;
+
+    if (!written)
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        runError = true;
+    }
+    return written;
+}
+
+int64_t BookBuilder::merge(const std::string& outputPath, std::ostream& log)
+{
+    // A buffer for every run being read and one for the run being written
+    size_t bufferSize = std::max<size_t>(settings.memory, 1) * 1024 * 1024 / (MAX_MERGE_RUNS + 1);
+    if (bufferSize > RUN_BUFFER_SIZE) bufferSize = RUN_BUFFER_SIZE;
+    if (bufferSize < MIN_RUN_BUFFER_SIZE) bufferSize = MIN_RUN_BUFFER_SIZE;
+
+    // The oldest runs are merged into a new one at the back, so every run goes through about as many passes.
+    // Records of the same move are added up whichever runs they meet in, so the book does not depend on the passes.
+    size_t nextRun = runPaths.size();
+    bool ok = true;
+    while (ok && runPaths.size() > MAX_MERGE_RUNS)
+    {
+        const std::vector<std::string> group(runPaths.begin(), runPaths.begin() + MAX_MERGE_RUNS);
+        runPaths.erase(runPaths.begin(), runPaths.begin() + MAX_MERGE_RUNS);
+
+        const std::string path = runPrefix + std::to_string(nextRun++);
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (file != nullptr)
+        {
+            std::setvbuf(file, nullptr, _IOFBF, bufferSize);
+            runPaths.push_back(path);
+        }
+
+        ok = file != nullptr && mergeRuns(group, bufferSize, [file](const Record& record) { return std::fwrite(&record, sizeof(Record), 1, file) == 1; }, log);
+        if (file != nullptr && std::fclose(file) != 0) ok = false;
+        if (!ok) log << "Could not write " << path << std::endl;
+    }
+
+    BufferedWriter writer;
+    if (ok && !writer.open(outputPath))
+    {
+        log << "Could not create " << outputPath << std::endl;
+        ok = false;
+    }
+    if (!ok)
+    {
+        for (const std::string& path : runPaths) std::remove(path.c_str());
+        runPaths.clear();
+        return -1;
+    }
+
+    // The moves of a position come out next to each other
+    std::vector<Record> moves;
+    std::string out;
+    int64_t entries = 0;
+    ok = mergeRuns(runPaths, bufferSize, [&](const Record& record)
+    {
+        if (!moves.empty() && moves.back().key != record.key)
+        {
+            entries += appendPosition(moves, out);
+            moves.clear();
+            if (out.size() >= WRITE_CHUNK_SIZE)
+            {
+                writer.write(std::move(out));
+                out.clear();
+            }
+        }
+        moves.push_back(record);
+        return true;
+    }, log);
+    runPaths.clear();
+
+    if (!ok) return -1;
+    if (!moves.empty()) entries += appendPosition(moves, out);
+    writer.write(std::move(out));
+    if (!writer.close())
+    {
+        log << "Could not write all of " << outputPath << std::endl;
+        return -1;
+    }
+    return entries;
+}
+
+bool BookBuilder::mergeRuns(const std::vector<std::string>& paths, size_t bufferSize, const std::function<bool(const Record&)>& callback, std::ostream& log)
+{
+    struct Run
+    {
+        FILE* file;
+        Record next;
+    };
+
+    std::vector<Run> runs;
+    bool ok = true;
+    for (const std::string& path : paths)
+    {
+        Run run = { std::fopen(path.c_str(), "rb"), Record() };
+        if (run.file == nullptr)
+        {
+            log << "Could not read " << path << std::endl;
+            ok = false;
+            continue;
+        }
+        std::setvbuf(run.file, nullptr, _IOFBF, bufferSize);
+        if (std::fread(&run.next, sizeof(Record), 1, run.file) == 1) runs.push_back(run);
+        else std::fclose(run.file);
+    }
+
+    // The run with the smallest next record comes out first
+    auto isAfter = [&runs](size_t lhs, size_t rhs) { return isBefore(runs[rhs].next, runs[lhs].next); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(isAfter)> queue(isAfter);
+    for (size_t i = 0; i != runs.size(); ++i) queue.push(i);
+
+    // Counts of a move can be spread over many runs. A record with a count of 0 is none.
+    Record merged;
+    while (ok && !queue.empty())
+    {
+        const size_t index = queue.top();
+        queue.pop();
+        const Record record = runs[index].next;
+        if (std::fread(&runs[index].next, sizeof(Record), 1, runs[index].file) == 1) queue.push(index);
+
+        if (merged.count != 0 && merged.key == record.key && merged.move == record.move)
+        {
+            merged.count += record.count;
+            merged.points += record.points;
+            continue;
+        }
+        if (merged.count != 0 && !callback(merged)) ok = false;
+        merged = record;
+    }
+    if (ok && merged.count != 0 && !callback(merged)) ok = false;
+
+    for (Run& run : runs) std::fclose(run.file);
+    for (const std::string& path : paths) std::remove(path.c_str());
+    return ok;
+}
+
+int BookBuilder::appendPosition(std::vector<Record>& moves, std::string& out) const
+{
+    auto isFiltered = [this](const Record& record)
+    {
+        return record.count < (uint32_t)settings.minCount || (uint64_t)record.points * 100 < (uint64_t)settings.minScore * 2 * record.count;
+    };
+    moves.erase(std::remove_if(moves.begin(), moves.end(), isFiltered), moves.end());
+
+    // Weights are the points scored, scaled down for positions played too often to fit them in 16 bits
+    uint32_t maxPoints = 0;
+    for (const Record& record : moves) maxPoints = std::max(maxPoints, record.points);
+    std::sort(moves.begin(), moves.end(), [](const Record& lhs, const Record& rhs) { return lhs.points > rhs.points; });
+
+    for (const Record& record : moves)
+    {
+        const uint64_t weight = maxPoints > 0xFFFF ? (uint64_t)record.points * 0xFFFF / maxPoints : record.points;
+
+        // Big-endian key, move, weight and a learn field left at 0
+        unsigned char entry[16] = {};
+        for (int i = 0; i < 8; ++i) entry[i] = (unsigned char)(record.key >> (56 - 8 * i));
+        entry[8] = (unsigned char)(record.move >> 8);
+        entry[9] = (unsigned char)record.move;
+        entry[10] = (unsigned char)(weight >> 8);
+        entry[11] = (unsigned char)weight;
+        out.append((const char*)entry, sizeof(entry));
+    }
+    return (int)moves.size();
+}
+
+bool BookBuilder::isBefore(const Record& lhs, const Record& rhs)
+{
+    return lhs.key < rhs.key || (lhs.key == rhs.key && lhs.move < rhs.move);
+}
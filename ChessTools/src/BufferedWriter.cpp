@@ -0,0 +1,74 @@
+#include "BufferedWriter.h"
+
+BufferedWriter::BufferedWriter() : queue(QUEUE_CAPACITY), file(nullptr), ownsFile(false), failed(false), bytesWritten(0)
+{
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    close();
+}
+
+bool BufferedWriter::open(const std::string& path)
+{
+    if (path == "-")
+    {
+        file = stdout;
+        ownsFile = false;
+    }
+    else
+    {
+        // Binary so packed records are written as they are, and text keeps its \n line ends
+        file = fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+        ownsFile = true;
+    }
+
+    thread = std::thread(&BufferedWriter::run, this);
+    return true;
+}
+
+void BufferedWriter::write(std::string chunk)
+{
+    queue.push(std::move(chunk));
+}
+
+bool BufferedWriter::close()
+{
+    if (file == nullptr) return !failed;
+
+    queue.close();
+    if (thread.joinable()) thread.join();
+
+    if (fflush(file) != 0) failed = true;
+    if (ownsFile && fclose(file) != 0) failed = true;
+    file = nullptr;
+    return !failed;
+}
+
+uint64_t BufferedWriter::getBytesWritten() const
+{
+    return bytesWritten.load(std::memory_order_relaxed);
+}
+
+void BufferedWriter::run()
+{
+    std::string block;
+    block.reserve(BLOCK_SIZE);
+
+    std::string chunk;
+    while (queue.pop(chunk))
+    {
+        block += chunk;
+        if (block.size() >= BLOCK_SIZE) flush(block);
+    }
+    flush(block);
+}
+
+void BufferedWriter::flush(std::string& block)
+{
+    if (block.empty()) return;
+    if (fwrite(block.data(), 1, block.size(), file) != block.size()) failed = true;
+    bytesWritten.fetch_add(block.size(), std::memory_order_relaxed);
+    block.clear();
+}
@@ -0,0 +1,76 @@
+#include "CommandLine.h"
+#include <charconv>
+#include <cstdlib>
+
+CommandLine::CommandLine(int argc, char* argv[], int first)
+{
+    for (int i = first; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0)
+        {
+            const std::string name = arg.substr(2);
+            const bool hasValue = i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0;
+            options[name] = hasValue ? argv[++i] : "";
+            used[name] = false;
+        }
+        else positional.push_back(arg);
+    }
+}
+
+const std::vector<std::string>& CommandLine::getPositional() const
+{
+    return positional;
+}
+
+bool CommandLine::has(const std::string& name)
+{
+    if (options.count(name) == 0) return false;
+    used[name] = true;
+    return true;
+}
+
+std::string CommandLine::getString(const std::string& name, const std::string& fallback)
+{
+    return has(name) ? options[name] : fallback;
+}
+
+int64_t CommandLine::getInt(const std::string& name, int64_t fallback)
+{
+    if (!has(name)) return fallback;
+
+    const std::string& value = options[name];
+    int64_t result = 0;
+    const std::from_chars_result parsed = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (parsed.ec != std::errc() || parsed.ptr != value.data() + value.size())
+    {
+        if (error.empty()) error = "--" + name + " needs a whole number";
+        return fallback;
+    }
+    return result;
+}
+
+double CommandLine::getDouble(const std::string& name, double fallback)
+{
+    if (!has(name)) return fallback;
+
+    const std::string& value = options[name];
+    char* end = nullptr;
+    const double result = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0')
+    {
+        if (error.empty()) error = "--" + name + " needs a number";
+        return fallback;
+    }
+    return result;
+}
+
+std::string CommandLine::getError() const
+{
+    if (!error.empty()) return error;
+    for (const auto& option : used)
+    {
+        if (!option.second) return "Unknown option --" + option.first;
+    }
+    return "";
+}
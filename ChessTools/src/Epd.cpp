@@ -0,0 +1,89 @@
+#include "Epd.h"
+
+bool Epd::nextLine(std::string_view& text, std::string_view& line)
+{
+    if (text.empty()) return false;
+
+    const size_t end = text.find('\n');
+    line = text.substr(0, end);
+    text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return true;
+}
+
+bool Epd::split(std::string_view line, std::string_view& fen, std::string_view& operations)
+{
+    line = trim(line);
+    if (line.empty() || line[0] == '#') return false;
+
+    // End of the fourth field
+    size_t end = 0;
+    for (int field = 0; field < 4 && end != std::string_view::npos; ++field)
+    {
+        end = line.find_first_not_of(' ', end);
+        if (end != std::string_view::npos) end = line.find(' ', end);
+    }
+    if (end == std::string_view::npos) end = line.size();
+
+    // A FEN goes on with two numbers, an EPD with operations
+    std::string_view rest = trim(line.substr(end));
+    const size_t firstEnd = rest.find(' ');
+    const std::string_view first = rest.substr(0, firstEnd);
+    const std::string_view afterFirst = firstEnd == std::string_view::npos ? std::string_view() : trim(rest.substr(firstEnd));
+    const std::string_view second = afterFirst.substr(0, afterFirst.find(' '));
+    if (isNumber(first) && isNumber(second))
+    {
+        end = line.size() - afterFirst.size() + second.size();
+        rest = trim(line.substr(end));
+    }
+
+    fen = line.substr(0, end);
+    operations = rest;
+    return true;
+}
+
+std::string_view Epd::getOperation(std::string_view operations, std::string_view opcode)
+{
+    while (!operations.empty())
+    {
+        // Operations end at a semicolon outside quotes
+        size_t end = 0;
+        bool quoted = false;
+        while (end < operations.size() && (quoted || operations[end] != ';'))
+        {
+            if (operations[end] == '"') quoted = !quoted;
+            ++end;
+        }
+
+        const std::string_view operation = trim(operations.substr(0, end));
+        operations = end < operations.size() ? operations.substr(end + 1) : std::string_view();
+
+        const size_t opcodeEnd = operation.find(' ');
+        if (operation.substr(0, opcodeEnd) != opcode) continue;
+        if (opcodeEnd == std::string_view::npos) return std::string_view();
+
+        std::string_view operands = trim(operation.substr(opcodeEnd));
+        if (operands.size() >= 2 && operands.front() == '"' && operands.back() == '"') operands = operands.substr(1, operands.size() - 2);
+        return operands;
+    }
+    return std::string_view();
+}
+
+std::string_view Epd::trim(std::string_view text)
+{
+    const size_t start = text.find_first_not_of(" \t");
+    if (start == std::string_view::npos) return std::string_view();
+    const size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+bool Epd::isNumber(std::string_view text)
+{
+    if (text.empty()) return false;
+    for (const char c : text)
+    {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
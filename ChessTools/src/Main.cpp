@@ -0,0 +1,210 @@
+#include <BatchAnalyzer.h>
+#include <SuiteRunner.h>
+#include <PgnReplayer.h>
+#include <PositionPacker.h>
+#include <PackedWriter.h>
+#include <SelfPlay.h>
+#include <BookBuilder.h>
+#include <CommandLine.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+static int analyzeBatch(CommandLine& args)
+{
+    BatchAnalyzer::Settings settings;
+    settings.threads = (int)args.getInt("threads", 1);
+    settings.hashSize = (size_t)args.getInt("hash", 16);
+    settings.depth = (int)args.getInt("depth", 0);
+    settings.nodes = (uint64_t)args.getInt("nodes", 0);
+    settings.moveTime = args.getInt("movetime", 0);
+    const std::string output = args.getString("output", "-");
+
+    const std::string error = args.getError();
+    if (args.getPositional().size() != 1 || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: analyze-batch <input> [--output <file>] [--threads <n>] [--hash <mb>] [--depth <n>] [--nodes <n>] [--movetime <ms>]" << std::endl;
+        return 1;
+    }
+
+    BatchAnalyzer analyzer(settings);
+    return analyzer.run(args.getPositional()[0], output, std::cerr) ? 0 : 1;
+}
+
+// Switches off the techniques in a comma separated list, named like the rows of bench-pruning
+static bool disableTechniques(const std::string& list, Search::Options& options, std::string& error)
+{
+    size_t start = 0;
+    while (start < list.size())
+    {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        const std::string name = list.substr(start, end - start);
+        start = end + 1;
+
+        if (name == "null-move") options.nullMove = false;
+        else if (name == "lmr") options.lateMoveReductions = false;
+        else if (name == "lmp") options.lateMovePruning = false;
+        else if (name == "see") options.seePruning = false;
+        else if (name == "reverse-futility") options.reverseFutility = false;
+        else if (name == "futility") options.futility = false;
+        else if (name == "razoring") options.razoring = false;
+        else
+        {
+            error = "Unknown technique " + name + ", expected null-move, lmr, lmp, see, reverse-futility, futility or razoring";
+            return false;
+        }
+    }
+    return true;
+}
+
+static int epd(CommandLine& args)
+{
+    SuiteRunner::Settings settings;
+    settings.threads = (int)args.getInt("threads", 1);
+    settings.hashSize = (size_t)args.getInt("hash", 16);
+    settings.depth = (int)args.getInt("depth", 0);
+    settings.nodes = (uint64_t)args.getInt("nodes", 0);
+    settings.moveTime = args.getInt("movetime", 0);
+    settings.stableIterations = (int)args.getInt("stable", 0);
+    const std::string disabled = args.getString("disable", "");
+
+    std::string error = args.getError();
+    if (error.empty()) disableTechniques(disabled, settings.searchOptions, error);
+    if (args.getPositional().size() != 1 || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: epd <suite> [--threads <n>] [--hash <mb>] [--depth <n>] [--nodes <n>] [--movetime <ms>] [--stable <iterations>] [--disable <techniques>]" << std::endl;
+        return 1;
+    }
+
+    SuiteRunner runner(settings);
+    return runner.run(args.getPositional()[0], std::cout, std::cerr) ? 0 : 1;
+}
+
+static int pgn(CommandLine& args)
+{
+    const int threads = (int)args.getInt("threads", std::max(1u, std::thread::hardware_concurrency()));
+
+    const std::string error = args.getError();
+    if (args.getPositional().size() != 1 || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: pgn <games> [--threads <n>]" << std::endl;
+        return 1;
+    }
+
+    PgnReplayer replayer(threads);
+    return replayer.run(args.getPositional()[0], std::cerr) ? 0 : 1;
+}
+
+static int pack(CommandLine& args)
+{
+    const int threads = (int)args.getInt("threads", std::max(1u, std::thread::hardware_concurrency()));
+
+    const std::string error = args.getError();
+    if (args.getPositional().size() != 2 || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: pack <positions or games> <output> [--threads <n>]" << std::endl;
+        return 1;
+    }
+
+    const std::string& input = args.getPositional()[0];
+    PackedWriter output;
+    if (!output.open(args.getPositional()[1]))
+    {
+        std::cerr << "Could not create " << args.getPositional()[1] << std::endl;
+        return 1;
+    }
+
+    // Anything that is not a .pgn file is read as FEN or EPD lines
+    const bool games = input.size() >= 4 && input.compare(input.size() - 4, 4, ".pgn") == 0;
+    const bool ok = games ? PositionPacker::packPgn(input, output, threads, std::cerr) : PositionPacker::packText(input, output, std::cerr);
+    return output.close() && ok ? 0 : 1;
+}
+
+static int unpack(CommandLine& args)
+{
+    const std::string output = args.getString("output", "-");
+    const uint64_t start = (uint64_t)args.getInt("start", 0);
+    const uint64_t count = (uint64_t)args.getInt("count", 0);
+
+    const std::string error = args.getError();
+    if (args.getPositional().size() != 1 || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: unpack <packed> [--output <file>] [--start <index>] [--count <n>]" << std::endl;
+        return 1;
+    }
+
+    return PositionPacker::unpack(args.getPositional()[0], output, start, count, std::cerr) ? 0 : 1;
+}
+
+static int selfPlay(CommandLine& args)
+{
+    SelfPlay::Settings settings;
+    settings.threads = (int)args.getInt("threads", std::max(1u, std::thread::hardware_concurrency()));
+    settings.hashSize = (size_t)args.getInt("hash", 8);
+    settings.games = (uint64_t)args.getInt("games", 1000);
+    settings.depth = (int)args.getInt("depth", 0);
+    settings.nodes = (uint64_t)args.getInt("nodes", 0);
+    settings.randomPlies = (int)args.getInt("random-plies", 8);
+    settings.seed = (uint64_t)args.getInt("seed", 0);
+    const std::string openings = args.getString("openings", "");
+
+    const std::string error = args.getError();
+    if (args.getPositional().size() != 1 || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: selfplay <output> [--games <n>] [--threads <n>] [--hash <mb>] [--depth <n>] [--nodes <n>] [--openings <file>] [--random-plies <n>] [--seed <n>]" << std::endl;
+        return 1;
+    }
+
+    SelfPlay selfPlay(settings);
+    if (!openings.empty() && !selfPlay.loadOpenings(openings, std::cerr)) return 1;
+    return selfPlay.run(args.getPositional()[0], std::cerr) ? 0 : 1;
+}
+
+static int book(CommandLine& args)
+{
+    BookBuilder::Settings settings;
+    settings.threads = (int)args.getInt("threads", std::max(1u, std::thread::hardware_concurrency()));
+    settings.maxPly = (int)args.getInt("max-ply", 20);
+    settings.minCount = (int)args.getInt("min-count", 3);
+    settings.minScore = (int)args.getInt("min-score", 0);
+    settings.memory = (size_t)args.getInt("memory", 256);
+    const std::string output = args.getString("output", "");
+
+    const std::string error = args.getError();
+    if (args.getPositional().empty() || output.empty() || !error.empty())
+    {
+        if (!error.empty()) std::cerr << error << std::endl;
+        std::cerr << "Usage: book <games> [<games> ...] --output <book.bin> [--threads <n>] [--max-ply <n>] [--min-count <n>] [--min-score <percent>] [--memory <mb>]" << std::endl;
+        return 1;
+    }
+
+    BookBuilder builder(settings);
+    return builder.run(args.getPositional(), output, std::cerr) ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    // Offline tools that share the engine, e.g. "chessbot-tools analyze-batch positions.epd --threads 8 --depth 12".
+    // Results go to standard output or the --output file, progress to standard error.
+    const std::string command = argc > 1 ? argv[1] : "";
+    CommandLine args(argc, argv, 2);
+
+    if (command == "analyze-batch") return analyzeBatch(args);
+    if (command == "epd") return epd(args);
+    if (command == "pgn") return pgn(args);
+    if (command == "pack") return pack(args);
+    if (command == "unpack") return unpack(args);
+    if (command == "selfplay") return selfPlay(args);
+    if (command == "book") return book(args);
+
+    std::cerr << "Commands: analyze-batch, epd, pgn, pack, unpack, selfplay, book" << std::endl;
+    return 1;
+}
@@ -0,0 +1,32 @@
+#include "PackedFile.h"
+
+PackedFile::PackedFile() : records(nullptr), count(0)
+{
+}
+
+bool PackedFile::open(const std::string& path)
+{
+    records = nullptr;
+    count = 0;
+    if (!file.open(path)) return false;
+    if (file.getSize() % sizeof(PackedPosition) != 0)
+    {
+        file.close();
+        return false;
+    }
+
+    // Mappings start on a page boundary, so the records are aligned
+    records = reinterpret_cast<const PackedPosition*>(file.getData());
+    count = file.getSize() / sizeof(PackedPosition);
+    return true;
+}
+
+size_t PackedFile::getCount() const
+{
+    return count;
+}
+
+const PackedPosition& PackedFile::operator[](size_t index) const
+{
+    return records[index];
+}
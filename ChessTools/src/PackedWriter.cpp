@@ -0,0 +1,27 @@
+#include "PackedWriter.h"
+
+PackedWriter::PackedWriter() : count(0)
+{
+}
+
+bool PackedWriter::open(const std::string& path)
+{
+    return writer.open(path);
+}
+
+void PackedWriter::write(const PackedPosition* records, size_t recordCount)
+{
+    if (recordCount == 0) return;
+    writer.write(std::string(reinterpret_cast<const char*>(records), recordCount * sizeof(PackedPosition)));
+    count.fetch_add(recordCount, std::memory_order_relaxed);
+}
+
+bool PackedWriter::close()
+{
+    return writer.close();
+}
+
+uint64_t PackedWriter::getCount() const
+{
+    return count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,173 @@
+#include "PgnReader.h"
+#include <algorithm>
+
+PgnReader::PgnReader(std::string_view text) : text(text)
+{
+}
+
+bool PgnReader::nextGame(Game& game)
+{
+    // Tag lines first
+    size_t pos = 0;
+    size_t tagsStart = std::string_view::npos, tagsEnd = 0;
+    while (true)
+    {
+        while (pos < text.size() && isSpace(text[pos])) ++pos;
+        if (pos == text.size() || text[pos] != '[') break;
+
+        if (tagsStart == std::string_view::npos) tagsStart = pos;
+        pos = text.find('\n', pos);
+        if (pos == std::string_view::npos) pos = text.size();
+        tagsEnd = pos;
+    }
+
+    // Then the movetext, up to the next tag line outside a comment
+    const size_t movesStart = pos;
+    bool inComment = false;
+    while (pos < text.size())
+    {
+        const char c = text[pos];
+        if (inComment) inComment = c != '}';
+        else if (c == '{') inComment = true;
+        else if (c == ';')
+        {
+            pos = text.find('\n', pos);
+            if (pos == std::string_view::npos) pos = text.size();
+            continue;
+        }
+        else if (c == '\n' && pos + 1 < text.size() && text[pos + 1] == '[') break;
+        ++pos;
+    }
+
+    if (tagsStart == std::string_view::npos && pos == movesStart) return false;
+
+    game.tags = tagsStart == std::string_view::npos ? std::string_view() : text.substr(tagsStart, tagsEnd - tagsStart);
+    game.moves = text.substr(movesStart, pos - movesStart);
+    text = text.substr(pos);
+    return true;
+}
+
+bool PgnReader::nextMove(std::string_view& moves, std::string_view& san)
+{
+    size_t pos = 0;
+    while (pos < moves.size())
+    {
+        const char c = moves[pos];
+        if (isSpace(c))
+        {
+            ++pos;
+            continue;
+        }
+
+        // Comments
+        if (c == '{' || c == ';')
+        {
+            pos = moves.find(c == '{' ? '}' : '\n', pos);
+            if (pos == std::string_view::npos) pos = moves.size();
+            else ++pos;
+            continue;
+        }
+
+        // Variations, which can hold comments and other variations
+        if (c == '(')
+        {
+            int nesting = 0;
+            for (; pos < moves.size(); ++pos)
+            {
+                if (moves[pos] == '{')
+                {
+                    pos = moves.find('}', pos);
+                    if (pos == std::string_view::npos) pos = moves.size() - 1;
+                }
+                else if (moves[pos] == '(') ++nesting;
+                else if (moves[pos] == ')' && --nesting == 0) break;
+            }
+            ++pos;
+            continue;
+        }
+
+        // A closing bracket without a variation
+        if (c == ')')
+        {
+            ++pos;
+            continue;
+        }
+
+        size_t end = pos;
+        while (end < moves.size() && !isSpace(moves[end]) && moves[end] != '{' && moves[end] != '(' && moves[end] != ';' && moves[end] != ')') ++end;
+        std::string_view token = moves.substr(pos, end - pos);
+        pos = end;
+
+        // Annotation glyphs such as $1 or a loose !?, and the result of an unfinished game
+        if (token[0] == '$' || token[0] == '!' || token[0] == '?' || token == "*") continue;
+
+        // Move numbers, which the move itself can follow without a space as in "12.e4".
+        // Castling can be written with zeros, which is the only move starting with a digit.
+        if (token[0] >= '0' && token[0] <= '9' && token.compare(0, 3, "0-0") != 0)
+        {
+            size_t digits = 0;
+            while (digits < token.size() && token[digits] >= '0' && token[digits] <= '9') ++digits;
+            if (digits == token.size() || token[digits] != '.') continue; // A result, e.g. 1-0 or 1/2-1/2
+
+            while (digits < token.size() && token[digits] == '.') ++digits;
+            token.remove_prefix(digits);
+            if (token.empty()) continue;
+        }
+
+        san = token;
+        moves = moves.substr(pos);
+        return true;
+    }
+
+    moves = std::string_view();
+    return false;
+}
+
+std::vector<std::string_view> PgnReader::split(std::string_view text, int count)
+{
+    std::vector<std::string_view> parts;
+    if (count < 1) count = 1;
+
+    size_t start = 0;
+    for (int i = 1; i <= count && start < text.size(); ++i)
+    {
+        // Games start with their Event tag, so a part ends where the first game after its share of the text begins
+        size_t end = text.size();
+        if (i < count)
+        {
+            const size_t target = std::max(start, text.size() / count * i);
+            end = text.find("\n[Event ", target);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+        }
+
+        parts.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return parts;
+}
+
+bool PgnReader::isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+std::string_view PgnReader::Game::getTag(std::string_view name) const
+{
+    size_t pos = 0;
+    while (pos < tags.size())
+    {
+        size_t end = tags.find('\n', pos);
+        if (end == std::string_view::npos) end = tags.size();
+        const std::string_view line = tags.substr(pos, end - pos);
+        pos = end + 1;
+
+        // [Name "Value"]
+        if (line.size() < name.size() + 4 || line[0] != '[' || line.compare(1, name.size(), name) != 0 || line[name.size() + 1] != ' ') continue;
+
+        const size_t open = line.find('"', name.size() + 1);
+        const size_t close = line.rfind('"');
+        if (open == std::string_view::npos || close <= open) return std::string_view();
+        return line.substr(open + 1, close - open - 1);
+    }
+    return std::string_view();
+}
@@ -0,0 +1,109 @@
+#include "PgnReplayer.h"
+#include <MappedFile.h>
+#include <Engine.h>
+#include <Move.h>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+
+PgnReplayer::PgnReplayer(int threads) : threads(threads < 1 ? 1 : threads), games(0), moves(0), errors(0)
+{
+}
+
+void PgnReplayer::setMoveCallback(MoveCallback callback)
+{
+    moveCallback = callback;
+}
+
+int PgnReplayer::getThreads() const
+{
+    return threads;
+}
+
+bool PgnReplayer::run(const std::string& path, std::ostream& log)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        log << "Could not read " << path << std::endl;
+        return false;
+    }
+
+    games = 0;
+    moves = 0;
+    errors = 0;
+
+    const char* fileStart = (const char*)file.getData();
+    const std::vector<std::string_view> parts = PgnReader::split(std::string_view(fileStart, file.getSize()), threads);
+    errorMessages.assign(parts.size(), std::vector<std::string>());
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i != parts.size(); ++i) workers.emplace_back(&PgnReplayer::replayPart, this, (int)i, parts[i], fileStart);
+    for (std::thread& worker : workers) worker.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int reported = 0;
+    for (const std::vector<std::string>& messages : errorMessages)
+    {
+        for (const std::string& message : messages)
+        {
+            if (reported++ < MAX_REPORTED_ERRORS) log << message << std::endl;
+        }
+    }
+
+    log << "Replayed " << games.load() << " games (" << errors.load() << " with errors), " << moves.load() << " moves in "
+        << std::fixed << std::setprecision(2) << seconds << "s on " << parts.size() << " threads: "
+        << (uint64_t)(games.load() / seconds) << " games/sec, " << (uint64_t)(moves.load() / seconds) << " moves/sec" << std::endl;
+    return true;
+}
+
+void PgnReplayer::replayPart(int part, std::string_view text, const char* fileStart)
+{
+    Engine engine;
+    PgnReader reader(text);
+    PgnReader::Game game;
+
+    // Counted locally and added once, so the threads do not fight over the counters
+    uint64_t partGames = 0, partMoves = 0, partErrors = 0;
+    std::string error;
+
+    while (reader.nextGame(game))
+    {
+        ++partGames;
+
+        // Games from a set-up position say so with a FEN tag
+        const std::string_view fen = game.getTag("FEN");
+        bool ok = engine.loadFen(fen.empty() ? std::string_view(Engine::startingFen) : fen, &error);
+
+        std::string_view movetext = game.moves;
+        std::string_view san;
+        for (int ply = 0; ok && PgnReader::nextMove(movetext, san); ++ply)
+        {
+            Move move;
+            if (!engine.parseSan(san, move))
+            {
+                error = "Cannot play " + std::string(san);
+                ok = false;
+                break;
+            }
+
+            if (moveCallback && !moveCallback(part, engine, move, ply, game)) break;
+            engine.makePseudoLegalMove(move);
+            ++partMoves;
+        }
+
+        if (!ok)
+        {
+            ++partErrors;
+            if (errorMessages[part].size() < MAX_REPORTED_ERRORS)
+            {
+                errorMessages[part].push_back("Game at byte " + std::to_string(game.moves.data() - fileStart) + ": " + error);
+            }
+        }
+    }
+
+    games.fetch_add(partGames);
+    moves.fetch_add(partMoves);
+    errors.fetch_add(partErrors);
+}
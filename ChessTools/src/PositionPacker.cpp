@@ -0,0 +1,195 @@
+#include "PositionPacker.h"
+#include "PackedFile.h"
+#include "PackedWriter.h"
+#include "PgnReplayer.h"
+#include "BufferedWriter.h"
+#include "Epd.h"
+#include <MappedFile.h>
+#include <Engine.h>
+#include <Move.h>
+#include <vector>
+#include <charconv>
+#include <algorithm>
+
+bool PositionPacker::packText(const std::string& inputPath, PackedWriter& output, std::ostream& log)
+{
+    MappedFile input;
+    if (!input.open(inputPath))
+    {
+        log << "Could not read " << inputPath << std::endl;
+        return false;
+    }
+
+    Engine engine;
+    std::vector<PackedPosition> batch;
+    batch.reserve(BATCH_SIZE);
+    uint64_t lineNumber = 0, skipped = 0;
+    std::string error;
+
+    std::string_view text((const char*)input.getData(), input.getSize());
+    std::string_view line;
+    while (Epd::nextLine(text, line))
+    {
+        ++lineNumber;
+        std::string_view fen, operations;
+        if (!Epd::split(line, fen, operations)) continue;
+
+        PackedPosition packed;
+        error.clear();
+        if (!engine.loadFen(fen, &error) || !engine.encode(packed))
+        {
+            if (skipped++ < 10) log << "Line " << lineNumber << ": " << (error.empty() ? "Cannot be packed" : error) << std::endl;
+            continue;
+        }
+
+        // The first of the best moves, in SAN
+        const std::string_view bestMoves = Epd::getOperation(operations, "bm");
+        Move move;
+        if (!bestMoves.empty() && engine.parseSan(bestMoves.substr(0, bestMoves.find(' ')), move)) packed.bestMove = move.pack();
+
+        const std::string_view evaluation = Epd::getOperation(operations, "ce");
+        int score = 0;
+        if (!evaluation.empty() && std::from_chars(evaluation.data(), evaluation.data() + evaluation.size(), score).ec == std::errc())
+        {
+            packed.score = (int16_t)std::max(-32767, std::min(score, 32767));
+        }
+
+        packed.result = parseResult(Epd::getOperation(operations, "result"));
+
+        // EPD keeps the halfmove clock as an operation
+        const std::string_view clock = Epd::getOperation(operations, "hmvc");
+        int plies = 0;
+        if (!clock.empty() && std::from_chars(clock.data(), clock.data() + clock.size(), plies).ec == std::errc())
+        {
+            packed.halfmoveClock = (uint8_t)std::max(0, std::min(plies, 255));
+        }
+
+        batch.push_back(packed);
+        if (batch.size() == BATCH_SIZE)
+        {
+            output.write(batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+    output.write(batch.data(), batch.size());
+
+    log << "Packed " << output.getCount() << " positions, skipped " << skipped << std::endl;
+    return true;
+}
+
+bool PositionPacker::packPgn(const std::string& inputPath, PackedWriter& output, int threads, std::ostream& log)
+{
+    // Each thread fills its own batch, so the callback never locks
+    PgnReplayer replayer(threads);
+    std::vector<std::vector<PackedPosition>> batches(replayer.getThreads());
+
+    replayer.setMoveCallback([&batches, &output](int part, Engine& position, const Move& move, int, const PgnReader::Game& game)
+    {
+        PackedPosition packed;
+        if (!position.encode(packed)) return true;
+        packed.bestMove = move.pack();
+        packed.result = parseResult(game.getTag("Result"));
+
+        std::vector<PackedPosition>& batch = batches[part];
+        batch.push_back(packed);
+        if (batch.size() == BATCH_SIZE)
+        {
+            output.write(batch.data(), batch.size());
+            batch.clear();
+        }
+        return true;
+    });
+
+    if (!replayer.run(inputPath, log)) return false;
+    for (const std::vector<PackedPosition>& batch : batches) output.write(batch.data(), batch.size());
+
+    log << "Packed " << output.getCount() << " positions" << std::endl;
+    return true;
+}
+
+bool PositionPacker::unpack(const std::string& inputPath, const std::string& outputPath, uint64_t start, uint64_t count, std::ostream& log)
+{
+    PackedFile input;
+    if (!input.open(inputPath))
+    {
+        log << "Could not read " << inputPath << " as packed positions" << std::endl;
+        return false;
+    }
+
+    BufferedWriter output;
+    if (!output.open(outputPath))
+    {
+        log << "Could not create " << outputPath << std::endl;
+        return false;
+    }
+
+    Engine engine;
+    char fen[Engine::MAX_FEN_LENGTH];
+    std::string error;
+    std::string lines;
+    const uint64_t end = std::min<uint64_t>(input.getCount(), count == 0 ? input.getCount() : start + count);
+    for (uint64_t i = start; i < end; ++i)
+    {
+        const PackedPosition& packed = input[i];
+        if (!engine.decode(packed, &error))
+        {
+            log << "Record " << i << ": " << error << std::endl;
+            continue;
+        }
+
+        // EPD has no move counters
+        std::string_view position(fen, engine.writeFen(fen));
+        for (int fields = 0; fields < 2; ++fields) position = position.substr(0, position.rfind(' '));
+        lines += position;
+
+        Move move = Move::unpack(packed.bestMove);
+        if (packed.bestMove != 0 && engine.parseMove(Engine::moveToString(move), move))
+        {
+            lines += " bm ";
+            lines += engine.moveToSan(move);
+            lines += ';';
+        }
+        if (packed.score != PackedPosition::NO_SCORE)
+        {
+            lines += " ce ";
+            lines += std::to_string(packed.score);
+            lines += ';';
+        }
+        if (packed.result != PackedPosition::RESULT_UNKNOWN)
+        {
+            lines += " result \"";
+            lines += resultToString(packed.result);
+            lines += "\";";
+        }
+        lines += " hmvc ";
+        lines += std::to_string(packed.halfmoveClock);
+        lines += ";\n";
+
+        if (lines.size() >= 1 << 16)
+        {
+            output.write(std::move(lines));
+            lines.clear();
+        }
+    }
+    output.write(std::move(lines));
+    return output.close();
+}
+
+uint8_t PositionPacker::parseResult(std::string_view result)
+{
+    if (result == "1-0") return PackedPosition::RESULT_WHITE_WIN;
+    if (result == "0-1") return PackedPosition::RESULT_BLACK_WIN;
+    if (result == "1/2-1/2") return PackedPosition::RESULT_DRAW;
+    return PackedPosition::RESULT_UNKNOWN;
+}
+
+const char* PositionPacker::resultToString(uint8_t result)
+{
+    switch (result)
+    {
+    case PackedPosition::RESULT_WHITE_WIN: return "1-0";
+    case PackedPosition::RESULT_BLACK_WIN: return "0-1";
+    case PackedPosition::RESULT_DRAW: return "1/2-1/2";
+    }
+    return "*";
+}
@@ -0,0 +1,224 @@
+#include "SelfPlay.h"
+#include "Epd.h"
+#include <MappedFile.h>
+#include <Engine.h>
+#include <Search.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <iomanip>
+
+SelfPlay::SelfPlay(const Settings& settings) : settings(settings), gamesStarted(0), gamesDone(0), positionsDone(0), totalNodes(0), running(0)
+{
+    if (this->settings.threads < 1) this->settings.threads = 1;
+    if (this->settings.depth == 0 && this->settings.nodes == 0) this->settings.nodes = DEFAULT_NODES;
+    for (std::atomic<uint64_t>& count : results) count = 0;
+}
+
+bool SelfPlay::loadOpenings(const std::string& path, std::ostream& log)
+{
+    MappedFile input;
+    if (!input.open(path))
+    {
+        log << "Could not read " << path << std::endl;
+        return false;
+    }
+
+    // Checked once here, so a bad line cannot end a game before it starts
+    Engine engine;
+    uint64_t invalid = 0;
+    std::string_view text((const char*)input.getData(), input.getSize());
+    std::string_view line;
+    while (Epd::nextLine(text, line))
+    {
+        std::string_view fen, operations;
+        if (!Epd::split(line, fen, operations)) continue;
+        if (engine.loadFen(fen)) openings.emplace_back(fen);
+        else ++invalid;
+    }
+
+    log << "Loaded " << openings.size() << " openings (" << invalid << " invalid)" << std::endl;
+    return !openings.empty();
+}
+
+bool SelfPlay::run(const std::string& outputPath, std::ostream& log)
+{
+    if (!writer.open(outputPath))
+    {
+        log << "Could not create " << outputPath << std::endl;
+        return false;
+    }
+
+    running = settings.threads;
+    std::vector<std::thread> workers;
+    for (int i = 0; i != settings.threads; ++i) workers.emplace_back(&SelfPlay::work, this, i);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsedSeconds = [&start]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    // Progress every few seconds until the workers are done
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!finished.wait_for(lock, std::chrono::seconds(5), [this]() { return running == 0; }))
+        {
+            const double seconds = elapsedSeconds();
+            const uint64_t positions = positionsDone.load(std::memory_order_relaxed);
+            log << gamesDone.load(std::memory_order_relaxed) << " games, " << positions << " positions, " << (uint64_t)(positions / seconds)
+                << " positions/sec, " << (uint64_t)(positions / seconds / settings.threads) << " per thread" << std::endl;
+        }
+    }
+
+    for (std::thread& worker : workers) worker.join();
+    const bool written = writer.close();
+    const double seconds = elapsedSeconds();
+
+    const uint64_t positions = writer.getCount();
+    log << "Played " << gamesDone.load() << " games (+" << results[PackedPosition::RESULT_WHITE_WIN].load() << " =" << results[PackedPosition::RESULT_DRAW].load()
+        << " -" << results[PackedPosition::RESULT_BLACK_WIN].load() << ") in " << std::fixed << std::setprecision(2) << seconds << "s on " << settings.threads
+        << " threads: " << positions << " positions, " << (uint64_t)(positions / seconds) << " positions/sec, "
+        << (uint64_t)(positions / seconds / settings.threads) << " positions/sec per thread, " << (uint64_t)(totalNodes.load() / seconds) << " nodes/sec" << std::endl;
+
+    if (!written) log << "Could not write all of " << outputPath << std::endl;
+    return written;
+}
+
+void SelfPlay::work(int thread)
+{
+    Engine engine;
+    Search search;
+    search.setHashSize(settings.hashSize);
+
+    // Without a seed every run plays different games
+    std::mt19937_64 random(settings.seed != 0 ? settings.seed + thread : std::random_device()() + ((uint64_t)thread << 32));
+
+    std::vector<PackedPosition> batch;
+    batch.reserve(BATCH_SIZE + settings.maxPlies);
+    while (gamesStarted.fetch_add(1, std::memory_order_relaxed) < settings.games)
+    {
+        totalNodes.fetch_add(playGame(engine, search, random, batch), std::memory_order_relaxed);
+        gamesDone.fetch_add(1, std::memory_order_relaxed);
+
+        // Whole games at a time, so a batch never holds positions without a result
+        if (batch.size() >= BATCH_SIZE)
+        {
+            writer.write(batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+    writer.write(batch.data(), batch.size());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --running;
+    }
+    finished.notify_all();
+}
+
+uint64_t SelfPlay::playGame(Engine& engine, Search& search, std::mt19937_64& random, std::vector<PackedPosition>& batch)
+{
+    // Random moves can walk into mate, so the opening is drawn again until there is a game to play
+    static const int MAX_OPENING_ATTEMPTS = 100;
+    for (int attempt = 0; attempt < MAX_OPENING_ATTEMPTS && !startGame(engine, random); ++attempt);
+
+    Search::Limits limits;
+    if (settings.depth > 0) limits.depth = settings.depth;
+    limits.nodes = settings.nodes;
+    search.clearHash();
+
+    const size_t firstPosition = batch.size();
+    std::vector<Move> moves;
+    uint64_t nodes = 0;
+    int whiteWinningPlies = 0, blackWinningPlies = 0, levelPlies = 0;
+    uint8_t result = PackedPosition::RESULT_UNKNOWN;
+
+    for (int ply = 0; ; ++ply)
+    {
+        result = getGameResult(engine, moves);
+        if (result != PackedPosition::RESULT_UNKNOWN) break;
+        if (ply >= settings.maxPlies)
+        {
+            result = PackedPosition::RESULT_DRAW;
+            break;
+        }
+
+        search.prepare();
+        const Search::Result searched = search.go(engine, limits);
+        nodes += searched.nodes;
+
+        // Only quiet positions are kept, since the score of a position in the middle of an exchange says little about it
+        const int turn = engine.getTurn();
+        PackedPosition packed;
+        if (!engine.isInCheck(turn) && !Engine::isCapture(searched.bestMove) && searched.bestMove.promotion == 0 && engine.encode(packed))
+        {
+            packed.score = (int16_t)searched.score;
+            packed.bestMove = searched.bestMove.pack();
+            batch.push_back(packed);
+        }
+
+        // Adjudication, on the score from white's point of view
+        const int score = turn == (int)Engine::WHITE ? searched.score : -searched.score;
+        whiteWinningPlies = score >= settings.resignScore ? whiteWinningPlies + 1 : 0;
+        blackWinningPlies = score <= -settings.resignScore ? blackWinningPlies + 1 : 0;
+        levelPlies = ply >= settings.drawMinPly && std::abs(score) <= settings.drawScore ? levelPlies + 1 : 0;
+        if (whiteWinningPlies >= settings.resignPlies) result = PackedPosition::RESULT_WHITE_WIN;
+        else if (blackWinningPlies >= settings.resignPlies) result = PackedPosition::RESULT_BLACK_WIN;
+        else if (levelPlies >= settings.drawPlies) result = PackedPosition::RESULT_DRAW;
+        if (result != PackedPosition::RESULT_UNKNOWN) break;
+
+        engine.makePseudoLegalMove(searched.bestMove);
+    }
+
+    for (size_t i = firstPosition; i != batch.size(); ++i) batch[i].result = result;
+    positionsDone.fetch_add(batch.size() - firstPosition, std::memory_order_relaxed);
+    results[result].fetch_add(1, std::memory_order_relaxed);
+    return nodes;
+}
+
+bool SelfPlay::startGame(Engine& engine, std::mt19937_64& random)
+{
+    if (openings.empty()) engine.loadFen(Engine::startingFen);
+    else engine.loadFen(openings[random() % openings.size()]);
+
+    std::vector<Move> moves;
+    for (int ply = 0; ply < settings.randomPlies; ++ply)
+    {
+        moves.clear();
+        engine.getLegalMoves(moves);
+        if (moves.empty()) return false;
+        engine.makePseudoLegalMove(moves[random() % moves.size()]);
+    }
+
+    moves.clear();
+    engine.getLegalMoves(moves);
+    return !moves.empty();
+}
+
+uint8_t SelfPlay::getGameResult(Engine& engine, std::vector<Move>& moves)
+{
+    moves.clear();
+    engine.getLegalMoves(moves);
+    if (moves.empty())
+    {
+        if (!engine.isInCheck(engine.getTurn())) return PackedPosition::RESULT_DRAW;
+        return engine.getTurn() == (int)Engine::WHITE ? PackedPosition::RESULT_BLACK_WIN : PackedPosition::RESULT_WHITE_WIN;
+    }
+
+    // A position coming back once is taken as a draw, as the search does
+    if (engine.isRepetition() || engine.getHalfmoveClock() >= 100 || isInsufficientMaterial(engine)) return PackedPosition::RESULT_DRAW;
+    return PackedPosition::RESULT_UNKNOWN;
+}
+
+bool SelfPlay::isInsufficientMaterial(const Engine& engine)
+{
+    // Bare kings, or a single knight or bishop between them
+    const std::vector<Bitboard>& pieces = engine.getPiecePositions();
+    int minorPieces = 0;
+    for (int color = 0; color < 2; ++color)
+    {
+        const int offset = color * 6;
+        if (pieces[offset + Engine::PAWN - 1] | pieces[offset + Engine::ROOK - 1] | pieces[offset + Engine::QUEEN - 1]) return false;
+        minorPieces += (pieces[offset + Engine::KNIGHT - 1] | pieces[offset + Engine::BISHOP - 1]).popCount();
+    }
+    return minorPieces <= 1;
+}
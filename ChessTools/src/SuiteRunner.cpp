@@ -0,0 +1,238 @@
+#include "SuiteRunner.h"
+#include "Epd.h"
+#include <MappedFile.h>
+#include <Engine.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+
+SuiteRunner::SuiteRunner(const Settings& settings) : settings(settings), positionsDone(0)
+{
+    if (this->settings.threads < 1) this->settings.threads = 1;
+    if (this->settings.depth == 0 && this->settings.nodes == 0 && this->settings.moveTime == 0) this->settings.moveTime = DEFAULT_MOVE_TIME;
+}
+
+bool SuiteRunner::run(const std::string& suitePath, std::ostream& out, std::ostream& log)
+{
+    MappedFile suite;
+    if (!suite.open(suitePath))
+    {
+        log << "Could not read " << suitePath << std::endl;
+        return false;
+    }
+
+    // Suites are small, so the positions are found up front and every worker fills in its own outcome
+    std::vector<Job> positions;
+    std::string_view text((const char*)suite.getData(), suite.getSize());
+    std::string_view line;
+    uint64_t lineNumber = 0;
+    while (Epd::nextLine(text, line))
+    {
+        ++lineNumber;
+        Job job;
+        if (!Epd::split(line, job.fen, job.operations)) continue;
+
+        job.index = outcomes.size();
+        positions.push_back(job);
+        outcomes.emplace_back();
+        outcomes.back().lineNumber = lineNumber;
+        outcomes.back().id = std::string(Epd::getOperation(job.operations, "id"));
+    }
+
+    BoundedQueue<Job> jobs(settings.threads * QUEUE_SLOTS_PER_WORKER);
+    std::vector<std::thread> workers;
+    for (int i = 0; i != settings.threads; ++i) workers.emplace_back(&SuiteRunner::work, this, std::ref(jobs));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    for (const Job& job : positions)
+    {
+        jobs.push(job);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(5))
+        {
+            lastReport = now;
+            log << positionsDone.load(std::memory_order_relaxed) << " of " << positions.size() << " positions" << std::endl;
+        }
+    }
+
+    jobs.close();
+    for (std::thread& worker : workers) worker.join();
+
+    writeReport(out, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+void SuiteRunner::work(BoundedQueue<Job>& jobs)
+{
+    Engine engine;
+    Search search;
+    search.setHashSize(settings.hashSize);
+    search.setOptions(settings.searchOptions);
+
+    // Reports come from the search's main thread, which is this one
+    Tracker tracker;
+    search.setInfoCallback([this, &search, &tracker](const Search::Info& info) { onIteration(info, search, tracker); });
+
+    Job job;
+    while (jobs.pop(job))
+    {
+        runPosition(job, engine, search, tracker);
+        positionsDone.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SuiteRunner::runPosition(const Job& job, Engine& engine, Search& search, Tracker& tracker)
+{
+    Outcome& outcome = outcomes[job.index];
+
+    if (!engine.loadFen(job.fen, &outcome.error)) return;
+
+    const std::string_view bm = Epd::getOperation(job.operations, "bm");
+    const std::string_view am = Epd::getOperation(job.operations, "am");
+    tracker.bestMoves.clear();
+    tracker.avoidMoves.clear();
+    if (!parseMoves(engine, bm, tracker.bestMoves, outcome.error) || !parseMoves(engine, am, tracker.avoidMoves, outcome.error)) return;
+    if (tracker.bestMoves.empty() && tracker.avoidMoves.empty())
+    {
+        outcome.error = "No bm or am operation";
+        return;
+    }
+
+    if (!bm.empty()) outcome.expected = "bm " + std::string(bm);
+    if (!am.empty()) outcome.expected += (outcome.expected.empty() ? "am " : " am ") + std::string(am);
+
+    tracker.lastBest = Move();
+    tracker.unchangedIterations = 0;
+    tracker.outcome = &outcome;
+
+    Search::Limits limits;
+    if (settings.depth > 0) limits.depth = settings.depth;
+    limits.nodes = settings.nodes;
+    limits.moveTime = settings.moveTime;
+
+    // A fresh table for every position, so results do not depend on which worker got which position before
+    search.clearHash();
+
+    search.prepare();
+    const auto start = std::chrono::steady_clock::now();
+    const Search::Result result = search.go(engine, limits);
+    outcome.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    outcome.nodes = result.nodes;
+    outcome.depth = result.depth;
+
+    if (result.bestMove.originPiece == 0)
+    {
+        outcome.error = "No legal move";
+        return;
+    }
+    outcome.bestMove = engine.moveToSan(result.bestMove);
+
+    // The last iteration decides. It normally matches the last report, unless the search was cut short without one.
+    outcome.solved = tracker.isSolution(result.bestMove);
+    if (!outcome.solved) outcome.solvedDepth = 0;
+    else if (outcome.solvedDepth == 0)
+    {
+        outcome.solvedDepth = result.depth;
+        outcome.solvedTimeMs = outcome.timeMs;
+        outcome.solvedNodes = result.nodes;
+    }
+}
+
+void SuiteRunner::onIteration(const Search::Info& info, Search& search, Tracker& tracker)
+{
+    if (info.pv.empty()) return;
+
+    const Move& best = info.pv[0];
+    tracker.unchangedIterations = best == tracker.lastBest ? tracker.unchangedIterations + 1 : 1;
+    tracker.lastBest = best;
+
+    // Time to solution counts from the first of the iterations that kept the right move
+    Outcome& outcome = *tracker.outcome;
+    if (!tracker.isSolution(best)) outcome.solvedDepth = 0;
+    else if (outcome.solvedDepth == 0)
+    {
+        outcome.solvedDepth = info.depth;
+        outcome.solvedTimeMs = info.timeMs;
+        outcome.solvedNodes = info.nodes;
+    }
+
+    if (settings.stableIterations > 0 && tracker.unchangedIterations >= settings.stableIterations) search.stop();
+}
+
+bool SuiteRunner::Tracker::isSolution(const Move& move) const
+{
+    if (!bestMoves.empty()) return std::find(bestMoves.begin(), bestMoves.end(), move) != bestMoves.end();
+    return std::find(avoidMoves.begin(), avoidMoves.end(), move) == avoidMoves.end();
+}
+
+bool SuiteRunner::parseMoves(Engine& engine, std::string_view text, std::vector<Move>& moves, std::string& error)
+{
+    while (!text.empty())
+    {
+        const size_t end = text.find(' ');
+        const std::string_view san = text.substr(0, end);
+        text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+        if (san.empty()) continue;
+
+        Move move;
+        if (!engine.parseSan(san, move))
+        {
+            error = "Move " + std::string(san) + " is not legal";
+            return false;
+        }
+        moves.push_back(move);
+    }
+    return true;
+}
+
+void SuiteRunner::writeReport(std::ostream& out, double seconds) const
+{
+    out << std::setw(6) << "line" << "  " << std::left << std::setw(16) << "id" << std::setw(8) << "result" << std::setw(10) << "move"
+        << std::setw(20) << "expected" << std::right << std::setw(6) << "depth" << std::setw(10) << "time ms" << std::setw(12) << "nodes"
+        << std::setw(8) << "solved" << std::setw(10) << "at ms" << std::setw(12) << "at nodes" << std::endl;
+
+    int solved = 0, failed = 0, invalid = 0;
+    int64_t solutionMs = 0;
+    uint64_t solutionNodes = 0;
+    for (const Outcome& outcome : outcomes)
+    {
+        out << std::setw(6) << outcome.lineNumber << "  " << std::left << std::setw(16) << outcome.id;
+        if (!outcome.error.empty())
+        {
+            ++invalid;
+            out << "error   " << outcome.error << std::right << std::endl;
+            continue;
+        }
+
+        out << std::setw(8) << (outcome.solved ? "solved" : "failed") << std::setw(10) << outcome.bestMove << std::setw(20) << outcome.expected
+            << std::right << std::setw(6) << outcome.depth << std::setw(10) << outcome.timeMs << std::setw(12) << outcome.nodes;
+        if (outcome.solved)
+        {
+            ++solved;
+            solutionMs += outcome.solvedTimeMs;
+            solutionNodes += outcome.solvedNodes;
+            out << std::setw(8) << outcome.solvedDepth << std::setw(10) << outcome.solvedTimeMs << std::setw(12) << outcome.solvedNodes;
+        }
+        else
+        {
+            ++failed;
+            out << std::setw(8) << "-" << std::setw(10) << "-" << std::setw(12) << "-";
+        }
+        out << std::endl;
+    }
+
+    const int total = solved + failed;
+    out << std::endl;
+    out << "Solved " << solved << " of " << total << " (" << std::fixed << std::setprecision(1) << (total > 0 ? 100.0 * solved / total : 0.0) << "%)";
+    if (invalid > 0) out << ", " << invalid << " not run";
+    out << std::endl;
+    if (solved > 0)
+    {
+        out << "Time to solution: " << solutionMs << " ms total, " << solutionMs / solved << " ms average" << std::endl;
+        out << "Nodes to solution: " << solutionNodes << " total, " << solutionNodes / solved << " average" << std::endl;
+    }
+    out << "Ran in " << std::setprecision(2) << seconds << "s on " << settings.threads << " workers" << std::endl;
+}
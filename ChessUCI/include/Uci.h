@@ -0,0 +1,87 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <memory>
+#include <Engine.h>
+#include <Move.h>
+#include <Search.h>
+#include <OpeningBook.h>
+#include <Tablebases.h>
+
+/*
+* Responsible for talking to a chess GUI over the Universal Chess Interface.
+* Commands are read on the caller's thread and every search runs on its own thread,
+* so stop, isready and ponderhit are answered while the engine is thinking.
+*/
+class Uci
+{
+public:
+	Uci();
+	~Uci();
+
+	Uci(const Uci&) = delete;
+	Uci& operator=(const Uci&) = delete;
+
+	// Reads commands until quit or the end of the input
+	void loop(std::istream& in, std::ostream& out);
+
+private:
+	static const int DEFAULT_HASH = 16;
+	static const int MAX_HASH = 4096;
+	static const int MAX_THREADS = 256;
+	static const int MAX_MULTI_PV = 64;
+	static const int MAX_SYZYGY_MAPPED = 4096;
+
+	Engine position;
+	Search search;
+	int multiPv;
+	std::thread searchThread;
+
+	// Positions in the book are answered without searching
+	OpeningBook book;
+	bool ownBook;
+	std::mt19937_64 random;
+
+	// Endgame tablebases, probed by the search
+	std::shared_ptr<Tablebases> tablebases;
+
+	// Lines can come from both threads
+	std::ostream* output;
+	std::mutex outputMutex;
+
+	// searching is set while search.go() runs, so stop() only reaches a search that can still see it.
+	// An infinite or ponder search holds its best move until the GUI says stop or ponderhit.
+	std::mutex mutex;
+	std::condition_variable released;
+	bool searching;
+	bool holdBestMove;
+
+	// Only touched by the search thread
+	std::vector<Move> lastPv;
+
+	// Commands
+	void uci();
+	void setOption(std::istringstream& args);
+	void newGame();
+	void setPosition(std::istringstream& args);
+	void go(std::istringstream& args);
+	void stop();
+	void ponderHit();
+	void waitForSearch();
+
+	// Reads a spin option into result, clamped to its range. Says so and returns false if it is not a number.
+	bool parseSpin(const std::string& name, const std::string& value, int min, int max, int& result);
+
+	void runSearch(Engine root, Search::Limits limits);
+	void sendInfo(const Search::Info& info);
+	void send(const std::string& line);
+
+	// "cp 35" or "mate -3", in moves rather than plies
+	static std::string formatScore(int score);
+};
@@ -0,0 +1,9 @@
+#include <Uci.h>
+#include <iostream>
+
+int main()
+{
+    // Headless engine for chess GUIs and tournament managers, speaking UCI on stdin and stdout
+    Uci uci;
+    uci.loop(std::cin, std::cout);
+}
@@ -0,0 +1,282 @@
+#include "Uci.h"
+#include <algorithm>
+#include <cstdlib>
+#include <charconv>
+
+Uci::Uci() : multiPv(1), ownBook(true), random(std::random_device()()), tablebases(new Tablebases()), output(&std::cout), searching(false), holdBestMove(false)
+{
+    search.setHashSize(DEFAULT_HASH);
+    search.setTablebases(tablebases);
+    search.setInfoCallback([this](const Search::Info& info) { sendInfo(info); });
+}
+
+Uci::~Uci()
+{
+    stop();
+}
+
+void Uci::loop(std::istream& in, std::ostream& out)
+{
+    output = &out;
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream args(line);
+        std::string command;
+        args >> command;
+
+        if (command == "uci") uci();
+        else if (command == "isready") send("readyok");
+        else if (command == "setoption") setOption(args);
+        else if (command == "ucinewgame") newGame();
+        else if (command == "position") setPosition(args);
+        else if (command == "go") go(args);
+        else if (command == "stop") stop();
+        else if (command == "ponderhit") ponderHit();
+        else if (command == "quit") break;
+    }
+
+    stop();
+}
+
+void Uci::uci()
+{
+    send("id name ChessBot");
+    send("id author NoyaRoeT");
+    send("option name Hash type spin default " + std::to_string(DEFAULT_HASH) + " min 1 max " + std::to_string(MAX_HASH));
+    send("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_THREADS));
+    send("option name MultiPV type spin default 1 min 1 max " + std::to_string(MAX_MULTI_PV));
+    send("option name Ponder type check default false");
+    send("option name OwnBook type check default true");
+    send("option name BookFile type string default <empty>");
+    send("option name SyzygyPath type string default <empty>");
+    send("option name SyzygyMappedFiles type spin default " + std::to_string(Tablebases::DEFAULT_MAX_MAPPED) + " min 1 max " + std::to_string(MAX_SYZYGY_MAPPED));
+    send("uciok");
+}
+
+void Uci::setOption(std::istringstream& args)
+{
+    // setoption name <id> [value <x>], where both may contain spaces
+    std::string token, name, value;
+    args >> token;
+    while (args >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    std::getline(args >> std::ws, value);
+
+    // Options are only sent while the engine is idle, but a search still running would be using the tables
+    waitForSearch();
+
+    int number;
+    if (name == "Hash" && parseSpin(name, value, 1, MAX_HASH, number)) search.setHashSize(number);
+    else if (name == "Threads" && parseSpin(name, value, 1, MAX_THREADS, number)) search.setThreads(number);
+    else if (name == "MultiPV" && parseSpin(name, value, 1, MAX_MULTI_PV, number)) multiPv = number;
+    else if (name == "OwnBook") ownBook = value == "true";
+    else if (name == "BookFile")
+    {
+        if (value.empty() || value == "<empty>") book.close();
+        else if (book.load(value)) send("info string Loaded book " + value + " with " + std::to_string(book.getEntryCount()) + " entries");
+        else send("info string Could not load book " + value);
+    }
+    else if (name == "SyzygyPath")
+    {
+        const int count = tablebases->load(value);
+        if (count > 0) send("info string Found " + std::to_string(count) + " tablebase files for up to " + std::to_string(tablebases->getMaxPieces()) + " pieces");
+        else if (!value.empty() && value != "<empty>") send("info string No tablebase files in " + value);
+    }
+    else if (name == "SyzygyMappedFiles" && parseSpin(name, value, 1, MAX_SYZYGY_MAPPED, number)) tablebases->setMaxMapped(number);
+}
+
+bool Uci::parseSpin(const std::string& name, const std::string& value, int min, int max, int& result)
+{
+    // Out of range values are clamped like GUIs do, but anything that is not a number is refused
+    long long parsed = 0;
+    const std::from_chars_result end = std::from_chars(value.data(), value.data() + value.size(), parsed);
+    if (value.empty() || end.ec == std::errc::invalid_argument || end.ptr != value.data() + value.size())
+    {
+        send("info string " + name + " needs a whole number, keeping the old value");
+        return false;
+    }
+
+    if (end.ec == std::errc::result_out_of_range) parsed = value[0] == '-' ? min : max;
+    result = (int)std::max<long long>(min, std::min<long long>(parsed, max));
+    return true;
+}
+
+void Uci::newGame()
+{
+    waitForSearch();
+    search.clearHash();
+    position = Engine();
+}
+
+void Uci::setPosition(std::istringstream& args)
+{
+    waitForSearch();
+
+    std::string token;
+    args >> token;
+    if (token == "startpos")
+    {
+        position = Engine();
+        args >> token;
+    }
+    else if (token == "fen")
+    {
+        std::string fen, error;
+        while (args >> token && token != "moves") fen += token + " ";
+        if (!position.loadFen(fen, &error))
+        {
+            send("info string Invalid FEN: " + error);
+            return;
+        }
+    }
+    else return;
+
+    // Moves are played on the board so the search sees the game history for repetitions
+    if (token != "moves") return;
+    while (args >> token)
+    {
+        Move move;
+        if (!position.parseMove(token, move)) break;
+        position.makePseudoLegalMove(move);
+    }
+}
+
+void Uci::go(std::istringstream& args)
+{
+    waitForSearch();
+
+    Search::Limits limits;
+    int64_t times[2] = { 0, 0 };
+    int64_t increments[2] = { 0, 0 };
+    bool infinite = false;
+    bool ponder = false;
+
+    std::string token;
+    while (args >> token)
+    {
+        if (token == "depth") args >> limits.depth;
+        else if (token == "nodes") args >> limits.nodes;
+        else if (token == "movetime") args >> limits.moveTime;
+        else if (token == "wtime") args >> times[Engine::WHITE];
+        else if (token == "btime") args >> times[Engine::BLACK];
+        else if (token == "winc") args >> increments[Engine::WHITE];
+        else if (token == "binc") args >> increments[Engine::BLACK];
+        else if (token == "movestogo") args >> limits.movesToGo;
+        else if (token == "infinite") infinite = true;
+        else if (token == "ponder") ponder = true;
+    }
+
+    // The clock is the one we will have if the opponent plays the ponder move, so it applies from ponderhit on
+    limits.time = times[position.getTurn()];
+    limits.increment = increments[position.getTurn()];
+    limits.ponder = ponder;
+    limits.multiPv = multiPv;
+
+    // A book move goes out straight away, without a search. Analysis and pondering always search.
+    Move bookMove;
+    if (ownBook && !infinite && !ponder && book.pickMove(position, random(), bookMove))
+    {
+        send("info string Book move");
+        send("bestmove " + Engine::moveToString(bookMove));
+        return;
+    }
+
+    // The flags are reset here, under the lock stop() takes, so a stop that came in after the last search
+    // ended is not left behind for this one
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        searching = true;
+        holdBestMove = infinite || ponder;
+        search.prepare();
+    }
+    searchThread = std::thread(&Uci::runSearch, this, position, limits);
+}
+
+void Uci::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        holdBestMove = false;
+        if (searching) search.stop();
+    }
+    released.notify_all();
+
+    // The best move has been sent once the thread is gone
+    if (searchThread.joinable()) searchThread.join();
+}
+
+void Uci::waitForSearch()
+{
+    // A search with limits is left to finish. One that would only end on stop is stopped, since the GUI has moved on.
+    bool unbounded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unbounded = holdBestMove;
+    }
+    if (unbounded) stop();
+    else if (searchThread.joinable()) searchThread.join();
+}
+
+void Uci::ponderHit()
+{
+    // The move being pondered on was played. The search carries on with the time it has already used,
+    // and if it finished while pondering its move goes out now.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        holdBestMove = false;
+        if (searching) search.ponderHit();
+    }
+    released.notify_all();
+}
+
+void Uci::runSearch(Engine root, Search::Limits limits)
+{
+    lastPv.clear();
+    const Search::Result result = search.go(root, limits);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        searching = false;
+        released.wait(lock, [this]() { return !holdBestMove; });
+    }
+
+    // A null move means there was no legal move
+    if (result.bestMove.originPiece == 0)
+    {
+        send("bestmove 0000");
+        return;
+    }
+
+    std::string line = "bestmove " + Engine::moveToString(result.bestMove);
+    if (lastPv.size() > 1 && lastPv[0] == result.bestMove) line += " ponder " + Engine::moveToString(lastPv[1]);
+    send(line);
+}
+
+void Uci::sendInfo(const Search::Info& info)
+{
+    // Called by the main search thread once per iteration, so formatting here costs the search nothing measurable
+    if (info.multiPv == 1) lastPv = info.pv;
+
+    const int64_t nps = info.timeMs > 0 ? (int64_t)(info.nodes * 1000 / info.timeMs) : (int64_t)info.nodes;
+    std::ostringstream line;
+    line << "info depth " << info.depth << " multipv " << info.multiPv << " score " << formatScore(info.score) << " nodes " << info.nodes
+        << " nps " << nps << " time " << info.timeMs << " pv";
+    for (const Move& move : info.pv) line << " " << Engine::moveToString(move);
+    send(line.str());
+}
+
+void Uci::send(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    *output << line << std::endl;
+}
+
+std::string Uci::formatScore(int score)
+{
+    if (std::abs(score) < Search::MATE_SCORE - Search::MAX_PLY) return "cp " + std::to_string(score);
+
+    const int plies = Search::MATE_SCORE - std::abs(score);
+    const int moves = (plies + 1) / 2;
+    return "mate " + std::to_string(score > 0 ? moves : -moves);
+}